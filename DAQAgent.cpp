@@ -0,0 +1,59 @@
+#include <iostream>
+#include <csignal>
+#include <unistd.h>
+#include <DAQInterface.h>
+#include <LocalAgent.h>
+
+using namespace ToolFramework;
+
+// Node-local agent: client processes configured with 'local_agent <ring name>' hand their logs, monitoring
+// and requests to this process through shared memory, and it alone holds the discovery beacon, services
+// and multicast connections for the node.
+// usage: ./DAQAgent [config file = ./AgentConfig]
+
+namespace {
+  volatile std::sig_atomic_t running=1;
+  void Terminate(int){ running=0; }
+}
+
+int main(int argc, const char** argv){
+  
+  std::string config_file = (argc>1) ? argv[1] : "./AgentConfig";
+  
+  Store config;
+  config.Initialise(config_file);
+  std::string local_agent;
+  if(config.Get("local_agent",local_agent) && local_agent!=""){
+    std::cerr<<"The agent's own configuration must not set 'local_agent'"<<std::endl;
+    return 1;
+  }
+  
+  std::string ring_name="/daqinterface_agent";
+  unsigned int slots=1024;
+  unsigned int slot_size=16384;
+  unsigned int workers=8;
+  unsigned int priority_slots=16;
+  config.Get("agent_ring",ring_name);
+  config.Get("agent_slots",slots);
+  config.Get("agent_slot_size",slot_size);
+  config.Get("agent_workers",workers);
+  config.Get("agent_priority_slots",priority_slots);
+  
+  DAQInterface DAQ_inter(config_file);
+  LocalAgent agent(&DAQ_inter, workers);
+  if(!agent.Start(ring_name, slots, slot_size, priority_slots)){
+    std::cerr<<"Failed to create agent ring '"<<ring_name<<"'"<<std::endl;
+    return 1;
+  }
+  std::cout<<"DAQAgent serving ring '"<<ring_name<<"' ("<<slots<<" slots of "<<slot_size<<" bytes)"<<std::endl;
+  
+  std::signal(SIGINT, Terminate);
+  std::signal(SIGTERM, Terminate);
+  while(running) sleep(1);
+  
+  agent.Stop();
+  std::cout<<"DAQAgent stopping after "<<agent.Messages()<<" messages and "<<agent.Requests()<<" requests ("<<agent.PriorityRequests()<<" priority, "<<agent.Expired()<<" expired unserved, "<<agent.LateReplies()<<" served too late, "<<agent.Reclaimed()<<" slots reclaimed from dead or stalled clients)"<<std::endl;
+  
+  return 0;
+  
+}
@@ -0,0 +1,187 @@
+#include <iostream>
+#include <iomanip>
+#include <DAQInterface.h>
+#include <AgentBackend.h>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <algorithm>
+#include <future>
+#include <unistd.h>
+
+using namespace ToolFramework;
+
+// counts payload-sized allocations made on each thread, to show how many times a large payload is copied
+thread_local unsigned long large_allocations=0;
+const size_t large_payload = 1024*1024;
+
+void* operator new(std::size_t size){
+	if(size>=large_payload) ++large_allocations;
+	void* ptr = std::malloc(size ? size : 1);
+	if(!ptr) throw std::bad_alloc();
+	return ptr;
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// Measures submission throughput of the DAQInterface multicast path (SendLog / SendMonitoringData),
+// the monitoring aggregator and request/reply calls (SQLQuery, GetCalibrationData) as the number of
+// caller threads grows from 1 to 32, then checks the number of copies of a 1 MB payload made on the
+// caller's thread by the monitoring, async upload and agent client paths, exiting non-zero if any makes more.
+// Optionally, measures critical alarm latency while 8 threads saturate the request path with 5 MB queries,
+// against a latency objective (N.B. this sends real critical alarms: only run it against a test database).
+// usage: ./Example/Benchmark [messages per thread = 20000] [critical alarms = 0] [alarm SLO ms = 100] [config file = ./InterfaceConfig]
+// (a config with 'stand_in_backend 1' measures the library alone, without the network or a database. The
+// request/reply figures then reflect the stand-in's worker pool, not how NetworkBackend and the middleman
+// scale: for those, run it with the production config against a test database)
+
+double Run(unsigned int n_threads, unsigned long n_messages, std::function<void(unsigned int, unsigned long)> call){
+	
+	std::vector<std::thread> threads;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(unsigned int t=0; t<n_threads; ++t){
+		threads.emplace_back([&call, t, n_messages]{ for(unsigned long i=0; i<n_messages; ++i) call(t, i); });
+	}
+	for(std::thread& thread : threads) thread.join();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	
+	return (n_threads*n_messages)/elapsed.count();
+	
+}
+
+int main(int argc, const char** argv){
+	
+	unsigned long n_messages = (argc>1) ? std::stoul(argv[1]) : 20000;
+	
+	std::string Interface_configfile = (argc>4) ? argv[4] : "./InterfaceConfig";
+	DAQInterface DAQ_inter(Interface_configfile);
+	
+	MonitoringAggregator* aggregator = DAQ_inter.GetMonitoringAggregator();
+	std::vector<int> handles;
+	for(unsigned int t=0; t<32; ++t) handles.push_back(aggregator->Register("benchmark", "thread_"+std::to_string(t)));
+	
+	std::cout<<std::setw(8)<<"threads"<<std::setw(16)<<"SendLog/s"<<std::setw(16)<<"SendMon/s"<<std::setw(16)<<"Record/s"
+	         <<std::setw(16)<<"SQLQuery/s"<<std::setw(16)<<"GetCalib/s"<<std::endl;
+	DAQ_inter.SendCalibrationData("{\"gain\":1}", "benchmark");
+	
+	for(unsigned int n_threads=1; n_threads<=32; n_threads*=2){
+		
+		double logs = Run(n_threads, n_messages, [&DAQ_inter](unsigned int t, unsigned long i){
+			DAQ_inter.SendLog("benchmark log message", LogLevel::Debug3);
+		});
+		
+		double monitoring = Run(n_threads, n_messages, [&DAQ_inter](unsigned int t, unsigned long i){
+			DAQ_inter.SendMonitoringData("{\"value\":1}", "benchmark");
+		});
+		
+		double records = Run(n_threads, n_messages*10, [aggregator, &handles](unsigned int t, unsigned long i){
+			aggregator->Record(handles[t], i);
+		});
+		
+		// round trips are far slower than queueing a message, so fewer of them
+		double queries = Run(n_threads, n_messages/20, [&DAQ_inter](unsigned int t, unsigned long i){
+			std::string response;
+			DAQ_inter.SQLQuery("SELECT 1 AS value", response);
+		});
+		
+		double calibrations = Run(n_threads, n_messages/20, [&DAQ_inter](unsigned int t, unsigned long i){
+			std::string json_data;
+			DAQ_inter.GetCalibrationData(json_data);
+		});
+		
+		std::cout<<std::setw(8)<<n_threads<<std::setw(16)<<std::fixed<<std::setprecision(0)<<logs
+		         <<std::setw(16)<<monitoring<<std::setw(16)<<records<<std::setw(16)<<queries<<std::setw(16)<<calibrations<<std::endl;
+		
+	}
+	
+	// payload copies on the calling thread, checked against what each path promises:
+	// a const& payload is copied once onto the send queue, a moved one is handed over without copying,
+	// and the agent client builds its request once, so only the JSON escape copies the payload
+	bool copies_ok=true;
+	auto check = [&copies_ok](const std::string& path, const double copies, const double expected){
+		bool ok = copies<=expected;
+		copies_ok = copies_ok && ok;
+		std::cout<<"1 MB payload copies on the calling thread, "<<path<<": "<<copies<<" (at most "<<expected<<") "<<(ok ? "PASS" : "FAIL")<<std::endl;
+	};
+	
+	unsigned long copies[2]={0,0};
+	for(int moved=0; moved<2; ++moved){
+		for(int i=0; i<10; ++i){
+			std::string payload = "{\"data\":\""+std::string(large_payload, 'x')+"\"}";
+			unsigned long before = large_allocations;
+			if(moved) DAQ_inter.SendMonitoringData(std::move(payload), "benchmark");
+			else DAQ_inter.SendMonitoringData(payload, "benchmark");
+			copies[moved] += large_allocations - before;
+		}
+	}
+	check("SendMonitoringData const&", copies[0]/10., 1);
+	check("SendMonitoringData moved", copies[1]/10., 0);
+	
+	unsigned long async_copies=0;
+	for(int i=0; i<10; ++i){
+		std::string payload = "{\"data\":\""+std::string(large_payload, 'x')+"\"}";
+		unsigned long before = large_allocations;
+		std::future<bool> sent = DAQ_inter.SendCalibrationDataAsync(std::move(payload), "benchmark");
+		async_copies += large_allocations - before;
+		sent.wait();
+	}
+	check("SendCalibrationDataAsync moved", async_copies/10., 0);
+	
+	// no agent serves this ring, so the request times out once it has been written to a spill segment
+	SharedMemoryRing ring;
+	std::string ring_name = "/daq_benchmark_"+std::to_string(getpid());
+	if(ring.Create(ring_name, 4)){
+		AgentBackend agent("benchmark");
+		if(agent.Connect(ring_name)){
+			std::string payload(large_payload, 'x');
+			unsigned long before = large_allocations;
+			agent.SendCalibrationData(payload, "benchmark", "", 0, nullptr, 10);
+			check("AgentBackend::SendCalibrationData", large_allocations - before, 1);
+		}
+		ring.Close();
+	}
+	
+	unsigned int n_alarms = (argc>2) ? std::stoul(argv[2]) : 0;
+	double slo_ms = (argc>3) ? std::stod(argv[3]) : 100;
+	if(n_alarms){
+		std::atomic<bool> loaded{true};
+		std::atomic<unsigned long> bulk_requests{0};
+		std::vector<std::thread> bulk;
+		for(unsigned int t=0; t<8; ++t){
+			bulk.emplace_back([&]{
+				std::string response;
+				while(loaded){
+					DAQ_inter.SQLQuery("SELECT repeat('x', 5000000) AS bulk", response, 10000);
+					++bulk_requests;
+				}
+			});
+		}
+		std::this_thread::sleep_for(std::chrono::seconds(1)); // let the bulk load build up
+		
+		std::vector<double> latencies;
+		unsigned int failed=0;
+		for(unsigned int i=0; i<n_alarms; ++i){
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if(!DAQ_inter.SendAlarm("benchmark alarm latency probe "+std::to_string(i), true)) ++failed;
+			latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+		loaded=false;
+		for(std::thread& thread : bulk) thread.join();
+		
+		std::sort(latencies.begin(), latencies.end());
+		double p50 = latencies[latencies.size()/2];
+		double p99 = latencies[std::min(latencies.size()-1, (latencies.size()*99)/100)];
+		std::cout<<std::setprecision(2)<<"critical alarm latency under bulk load ("<<bulk_requests<<" 5 MB queries): p50 "<<p50<<" ms, p99 "<<p99
+		         <<" ms, max "<<latencies.back()<<" ms, "<<failed<<" failed -> "<<((p99<=slo_ms && !failed) ? "meets" : "MISSES")<<" "<<slo_ms<<" ms SLO"<<std::endl;
+	}
+	
+	MulticastSender* sender = DAQ_inter.GetMulticastSender();
+	std::cout<<"multicast sent: "<<sender->Sent()<<", failed: "<<sender->Failed()<<", dropped on a full queue: "<<sender->Dropped()<<std::endl;
+	
+	return copies_ok ? 0 : 1;
+	
+}
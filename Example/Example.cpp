@@ -169,6 +169,19 @@ int main(){
   DAQ_inter.sc_vars["voltage_3"]->SetValue(3800);
   if(verbose) std::cout<<"Done"<<std::endl;
   
+  // larger sets of controls can be registered in one go from a JSON (or Store) specification.
+  // the whole set is validated first, and either all controls are added or none are.
+  if(verbose) std::cout<<"\tRegistering 'current_limit_1' and 'current_limit_2' from a spec..."<<std::flush;
+  std::string sc_spec = "{"
+    "\"current_limit_1\":{\"type\":\"VARIABLE\", \"min\":0, \"max\":10, \"step\":0.5, \"value\":2.5, \"callback\":\"current_limit_change\"},"
+    "\"current_limit_2\":{\"type\":\"VARIABLE\", \"min\":0, \"max\":10, \"step\":0.5, \"value\":2.5}"
+  "}";
+  // callbacks are referenced in the spec by name
+  std::map<std::string, std::function<std::string(const char*)> > sc_callbacks;
+  sc_callbacks["current_limit_change"] = [](const char* key){ return std::string{"Changed current limit "}+key; };
+  if(!DAQ_inter.AddSlowControlVariables(sc_spec, sc_callbacks)) std::cerr<<"Failed to register slow controls from spec"<<std::endl;
+  else if(verbose) std::cout<<"Done"<<std::endl;
+  
   if(verbose) std::cout<<"All slow controls registered"<<std::endl;
   
   ////////////////////////////////////////////////////////////////////
@@ -257,6 +270,10 @@ int main(){
   
   Store monitoring_data; // sorage object for monitoring vales;
   
+  // A subject that always sends the same fields can register them once instead: SendMonitoringValues then
+  // sends just the values in this order, packed, and receivers expand them using the announced schema.
+  uint32_t hv_schema = DAQ_inter.RegisterMonitoringSchema("hv", {{"voltage_1", SchemaFieldType::Float}, {"voltage_2", SchemaFieldType::Float}, {"voltage_3", SchemaFieldType::Float}, {"power_on", SchemaFieldType::Int}});
+  
   /////////////////////////////////////////////////////////////////
 
   //////////////////////////////// a Plotly plot /////////////////
@@ -378,6 +395,16 @@ int main(){
       	std::cerr<<"sendmonitoringdata failed"<<std::endl;
       }
       
+      // Quantities sampled at high rate needn't be sent every sample: values recorded with
+      // RecordMonitoringValue are reduced to min/max/mean/rms/count and sent once per
+      // 'monitoring_window_ms'. Recording is cheap and safe to call from many threads.
+      // (for the hottest paths, fetch a handle once with GetMonitoringAggregator()->Register
+      // and record against that to avoid the name lookup)
+      for(int i=0; i<100; ++i) DAQ_inter.RecordMonitoringValue("fast", "adc_baseline", 200+(rand()%100)/10.);
+      
+      // the same setpoints as above, as positional values against the schema registered earlier
+      DAQ_inter.SendMonitoringValues(hv_schema, {DAQ_inter.sc_vars["voltage_1"]->GetValue<double>(), DAQ_inter.sc_vars["voltage_2"]->GetValue<double>(), DAQ_inter.sc_vars["voltage_3"]->GetValue<double>(), double(DAQ_inter.sc_vars["power_on"]->GetValue<int>())});
+      
       //////////////////////////////////////////////////////////////////////////////////////////
       
       ///////////////////////  using and getting slow control values /////////////// 
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <CallTrace.h>
+#include <StandInBackend.h>
+#include <RequestPipeline.h>
+
+using namespace ToolFramework;
+
+// Replays a call trace recorded with 'trace_file' in the InterfaceConfig against a local stand-in backend,
+// at a multiple of the recorded rate, and reports throughput, latency and failure rates per call type.
+// Latency is measured from when the call was due, so it includes any time spent queued for the in-flight window.
+// usage: ./Example/Replay <trace file> [speed = 1] [in-flight window = 64] [stand-in workers = 8]
+//                         [stand-in base latency us = 500] [stand-in bytes/us = 100]
+
+struct Stats{
+	unsigned long calls=0;
+	unsigned long failed=0;
+	std::vector<double> latencies_ms;
+	std::vector<double> recorded_ms;
+};
+
+double Percentile(std::vector<double>& values, double fraction){
+	
+	if(values.empty()) return 0;
+	std::sort(values.begin(), values.end());
+	
+	return values[std::min(values.size()-1, static_cast<size_t>(values.size()*fraction))];
+	
+}
+
+int main(int argc, const char** argv){
+	
+	if(argc<2){
+		std::cerr<<"usage: "<<argv[0]<<" <trace file> [speed = 1] [in-flight window = 64] [stand-in workers = 8] [stand-in base latency us = 500] [stand-in bytes/us = 100]"<<std::endl;
+		return 1;
+	}
+	
+	double speed = (argc>2) ? std::stod(argv[2]) : 1;
+	unsigned int window = (argc>3) ? std::stoul(argv[3]) : 64;
+	unsigned int workers = (argc>4) ? std::stoul(argv[4]) : 8;
+	unsigned int base_latency_us = (argc>5) ? std::stoul(argv[5]) : 500;
+	double bytes_per_us = (argc>6) ? std::stod(argv[6]) : 100;
+	if(speed<=0) speed=1;
+	
+	std::vector<TraceRecord> records;
+	if(!CallTrace::Read(argv[1], records)){
+		std::cerr<<"Could not read trace file '"<<argv[1]<<"'"<<std::endl;
+		return 1;
+	}
+	if(records.empty()){
+		std::cout<<"Trace is empty"<<std::endl;
+		return 0;
+	}
+	double recorded_s = (records.back().time_us - records.front().time_us)/1e6;
+	std::cout<<"Replaying "<<records.size()<<" calls spanning "<<recorded_s<<" s at "<<speed<<"x, window "<<window
+	         <<", stand-in with "<<workers<<" workers ("<<base_latency_us<<" us + bytes/"<<bytes_per_us<<")"<<std::endl;
+	
+	StandInBackend backend(workers, base_latency_us, bytes_per_us);
+	std::vector<double> latencies(records.size(), 0);
+	std::vector<char> ok(records.size(), 0);
+	std::vector<std::future<bool> > pending;
+	
+	{
+		RequestPipeline pipeline(window);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		
+		for(size_t i=0; i<records.size(); ++i){
+			
+			const TraceRecord& record = records[i];
+			std::chrono::steady_clock::time_point due = start + std::chrono::microseconds(static_cast<uint64_t>((record.time_us - records.front().time_us)/speed));
+			std::this_thread::sleep_until(due);
+			
+			// one-way messages don't wait for a reply, so send them from here like the multicast path would
+			if(record.timeout_ms==0){
+				ok[i] = backend.Serve(record.request_bytes, record.reply_bytes, 0);
+				latencies[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - due).count();
+				continue;
+			}
+			
+			pending.push_back(pipeline.Submit([&backend, &record, &latencies, &ok, i, due](const unsigned int remaining){
+				ok[i] = backend.Serve(record.request_bytes, record.reply_bytes, remaining);
+				latencies[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - due).count();
+				return static_cast<bool>(ok[i]);
+			}, record.timeout_ms));
+			
+		}
+		
+		for(std::future<bool>& result : pending) result.wait();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		
+		// requests that expired in the queue never ran: count them at their full timeout
+		for(size_t i=0; i<records.size(); ++i){
+			if(!ok[i] && latencies[i]==0) latencies[i] = records[i].timeout_ms;
+		}
+		
+		uint64_t bytes=0;
+		unsigned long failed=0;
+		std::map<TraceCall, Stats> stats;
+		for(size_t i=0; i<records.size(); ++i){
+			Stats& call = stats[records[i].call];
+			++call.calls;
+			if(!ok[i]){
+				++call.failed;
+				++failed;
+			}
+			call.latencies_ms.push_back(latencies[i]);
+			call.recorded_ms.push_back(records[i].latency_us/1000.);
+			bytes += records[i].request_bytes + records[i].reply_bytes;
+		}
+		
+		std::cout<<std::fixed<<std::setprecision(2);
+		std::cout<<"Completed in "<<elapsed.count()<<" s: "<<records.size()/elapsed.count()<<" calls/s, "
+		         <<bytes/elapsed.count()/1e6<<" MB/s, "<<(100.*failed)/records.size()<<"% failed ("
+		         <<pipeline.Expired()<<" expired before being sent, "<<backend.Rejected()<<" before being served, "<<backend.Cancelled()<<" cancelled while served)"<<std::endl;
+		std::cout<<std::setw(22)<<"call"<<std::setw(10)<<"count"<<std::setw(10)<<"failed%"<<std::setw(12)<<"p50 ms"
+		         <<std::setw(12)<<"p99 ms"<<std::setw(14)<<"recorded p50"<<std::setw(14)<<"recorded p99"<<std::endl;
+		for(std::pair<const TraceCall, Stats>& call : stats){
+			std::cout<<std::setw(22)<<TraceCallName(call.first)<<std::setw(10)<<call.second.calls
+			         <<std::setw(10)<<(100.*call.second.failed)/call.second.calls
+			         <<std::setw(12)<<Percentile(call.second.latencies_ms, 0.5)<<std::setw(12)<<Percentile(call.second.latencies_ms, 0.99)
+			         <<std::setw(14)<<Percentile(call.second.recorded_ms, 0.5)<<std::setw(14)<<Percentile(call.second.recorded_ms, 0.99)<<std::endl;
+		}
+	}
+	
+	return 0;
+	
+}
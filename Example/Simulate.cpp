@@ -0,0 +1,248 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <queue>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <DAQInterface.h>
+#include <NetworkBackend.h>
+#include <StandInBackend.h>
+#include <RequestPipeline.h>
+
+using namespace ToolFramework;
+
+// Simulates a large experiment from one process: thousands of lightweight virtual devices share a single
+// timer thread, each sending ServiceDiscovery-shaped beacons to a multicast group every beacon period
+// (all devices power on within the first second), and optionally each issuing a config request every
+// request period. Requests go through a pool of connections, each with its own services socket and the
+// UUID and name of one simulated device, so the middleman sees that many clients; devices share them round
+// robin, and a pool as large as the device count gives every device its own connection.
+// An in-process listener on the same group reports discovery convergence (time until every device has
+// been heard) and beacon load; request latency and failures show the fan-in.
+// The default group is deliberately not the production discovery group (239.192.1.1:5000); pass that
+// explicitly to load the real middleman. Use 'stand_in_backend 1' in the config file to exercise only
+// the client side. N.B. each pooled connection also runs its own discovery beacon as configured.
+// usage: ./Example/Simulate [devices = 1000] [duration s = 30] [beacon period ms = 5000] [request period ms = 0 (none)]
+//                           [multicast address = 239.192.1.99] [port = 5099] [config file = ./InterfaceConfig] [connections = 1]
+
+struct Event{
+	std::chrono::steady_clock::time_point when;
+	unsigned int device;
+	bool beacon; // else a request
+	bool operator>(const Event& other) const { return when>other.when; }
+};
+
+std::string MakeUUID(std::mt19937_64& rng){
+	
+	char uuid[37];
+	uint64_t a=rng(), b=rng();
+	snprintf(uuid, sizeof(uuid), "%08x-%04x-4%03x-%04x-%012llx", static_cast<unsigned int>(a>>32), static_cast<unsigned int>((a>>16)&0xffff),
+	         static_cast<unsigned int>(a&0xfff), static_cast<unsigned int>(0x8000 | ((b>>48)&0x3fff)), static_cast<unsigned long long>(b&0xffffffffffffULL));
+	
+	return uuid;
+	
+}
+
+int main(int argc, const char** argv){
+	
+	unsigned int n_devices = (argc>1) ? std::stoul(argv[1]) : 1000;
+	unsigned int duration_s = (argc>2) ? std::stoul(argv[2]) : 30;
+	unsigned int beacon_ms = (argc>3) ? std::stoul(argv[3]) : 5000;
+	unsigned int request_ms = (argc>4) ? std::stoul(argv[4]) : 0;
+	std::string address = (argc>5) ? argv[5] : "239.192.1.99";
+	unsigned int port = (argc>6) ? std::stoul(argv[6]) : 5099;
+	std::string config_file = (argc>7) ? argv[7] : "./InterfaceConfig";
+	unsigned int n_connections = (argc>8) ? std::stoul(argv[8]) : 1;
+	if(n_devices==0 || beacon_ms==0 || n_connections==0) return 1;
+	n_connections = std::min(n_connections, n_devices);
+	
+	// one socket sends every device's beacons, one listens to the group
+	sockaddr_in group{};
+	group.sin_family = AF_INET;
+	group.sin_port = htons(port);
+	if(inet_pton(AF_INET, address.c_str(), &group.sin_addr)!=1){
+		std::cerr<<"Invalid multicast address '"<<address<<"'"<<std::endl;
+		return 1;
+	}
+	int sender = socket(AF_INET, SOCK_DGRAM, 0);
+	int listener = socket(AF_INET, SOCK_DGRAM, 0);
+	unsigned char ttl=1, loop=1;
+	setsockopt(sender, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+	setsockopt(sender, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+	int reuse=1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	sockaddr_in bind_address{};
+	bind_address.sin_family = AF_INET;
+	bind_address.sin_port = htons(port);
+	bind_address.sin_addr.s_addr = htonl(INADDR_ANY);
+	ip_mreq membership{};
+	membership.imr_multiaddr = group.sin_addr;
+	membership.imr_interface.s_addr = htonl(INADDR_ANY);
+	timeval receive_timeout{0, 100000};
+	setsockopt(listener, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout, sizeof(receive_timeout));
+	if(sender<0 || listener<0 || bind(listener, reinterpret_cast<sockaddr*>(&bind_address), sizeof(bind_address))!=0 ||
+	   setsockopt(listener, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership))!=0){
+		std::cerr<<"Could not open multicast sockets on "<<address<<":"<<port<<": "<<strerror(errno)<<std::endl;
+		return 1;
+	}
+	
+	std::mt19937_64 rng(std::random_device{}());
+	std::vector<std::string> uuids, names;
+	for(unsigned int i=0; i<n_devices; ++i){
+		uuids.push_back(MakeUUID(rng));
+		names.push_back("sim_device_"+std::to_string(i));
+	}
+	
+	// connection k speaks for device k
+	std::vector<DAQBackend*> connections;
+	std::vector<SlowControlCollection*> connection_controls;
+	RequestPipeline* pipeline = nullptr;
+	if(request_ms){
+		Store vars;
+		vars.Initialise(config_file);
+		bool stand_in=false;
+		unsigned int workers=8;
+		unsigned int latency_us=500;
+		vars.Get("stand_in_backend",stand_in);
+		vars.Get("stand_in_workers",workers);
+		vars.Get("stand_in_latency_us",latency_us);
+		for(unsigned int k=0; k<n_connections; ++k){
+			if(stand_in){
+				connections.push_back(new StandInBackend(workers, latency_us));
+				continue;
+			}
+			Store connection_vars;
+			connection_vars.Initialise(config_file);
+			connection_vars.Set("UUID",uuids[k]);
+			connection_vars.Set("service_name",names[k]);
+			connection_controls.push_back(new SlowControlCollection());
+			connections.push_back(new NetworkBackend(connection_vars, connection_controls.back()));
+		}
+		pipeline = new RequestPipeline(8*n_connections); // as many in flight per connection as a DAQInterface allows by default
+	}
+	
+	std::atomic<bool> running{true};
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::atomic<unsigned long> beacons_sent{0}, beacon_bytes{0};
+	std::atomic<unsigned long> beacons_heard{0};
+	std::atomic<unsigned int> devices_heard{0};
+	std::atomic<double> convergence_s{-1};
+	std::mutex request_mtx;
+	std::vector<double> request_latencies;
+	unsigned long requests_failed=0;
+	
+	std::thread listen([&]{
+		std::unordered_set<std::string> heard;
+		char buffer[2048];
+		const std::string key = "\"uuid\":\"";
+		while(running){
+			ssize_t length = recv(listener, buffer, sizeof(buffer), 0);
+			if(length<=0) continue;
+			++beacons_heard;
+			std::string_view message(buffer, length);
+			size_t pos = message.find(key);
+			if(pos==std::string_view::npos) continue;
+			heard.emplace(message.substr(pos+key.size(), 36));
+			devices_heard = heard.size();
+			if(heard.size()==n_devices && convergence_s<0) convergence_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+	});
+	
+	// every device's beacons and requests come off one queue on one thread
+	std::priority_queue<Event, std::vector<Event>, std::greater<Event> > events;
+	std::uniform_int_distribution<unsigned int> power_on(0, 1000);
+	for(unsigned int i=0; i<n_devices; ++i){
+		events.push(Event{start + std::chrono::milliseconds(power_on(rng)), i, true});
+		if(request_ms) events.push(Event{start + std::chrono::milliseconds(power_on(rng)) + std::chrono::milliseconds(request_ms), i, false});
+	}
+	
+	std::chrono::steady_clock::time_point end = start + std::chrono::seconds(duration_s);
+	std::chrono::steady_clock::time_point next_report = start + std::chrono::seconds(1);
+	unsigned long last_beacons=0;
+	std::cout<<std::setw(8)<<"time s"<<std::setw(12)<<"heard"<<std::setw(14)<<"beacons/s"<<std::setw(12)<<"kB/s"<<std::setw(12)<<"requests"<<std::endl;
+	
+	while(!events.empty() && events.top().when<end){
+		
+		Event event = events.top();
+		events.pop();
+		std::this_thread::sleep_until(event.when);
+		
+		if(event.beacon){
+			uint64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			std::string beacon = "{\"msg_id\":"+std::to_string(beacons_sent.load())+",\"msg_type\":\"Service Discovery\",\"uuid\":\""+uuids[event.device]
+			                    +"\",\"msg_value\":\""+names[event.device]+"\",\"remote_port\":24011,\"status\":\"Online\",\"time\":"+std::to_string(now_ms)+"}";
+			if(sendto(sender, beacon.data(), beacon.size(), 0, reinterpret_cast<sockaddr*>(&group), sizeof(group))>0){
+				++beacons_sent;
+				beacon_bytes+=beacon.size();
+			}
+			event.when += std::chrono::milliseconds(beacon_ms);
+		}
+		else {
+			std::chrono::steady_clock::time_point issued = std::chrono::steady_clock::now();
+			const std::string& device = names[event.device];
+			DAQBackend* connection = connections[event.device % n_connections];
+			pipeline->Submit([&, issued, device, connection](const unsigned int remaining){
+				std::string json_data;
+				bool ok = connection->GetDeviceConfig(json_data, -1, device, remaining);
+				std::lock_guard<std::mutex> lock(request_mtx);
+				request_latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - issued).count());
+				if(!ok) ++requests_failed;
+				return ok;
+			}, 2000);
+			event.when += std::chrono::milliseconds(request_ms);
+		}
+		events.push(event);
+		
+		if(std::chrono::steady_clock::now()>=next_report){
+			size_t requests;
+			{
+				std::lock_guard<std::mutex> lock(request_mtx);
+				requests = request_latencies.size();
+			}
+			std::cout<<std::setw(8)<<std::chrono::duration_cast<std::chrono::seconds>(next_report - start).count()
+			         <<std::setw(12)<<devices_heard<<std::setw(14)<<(beacons_sent-last_beacons)
+			         <<std::setw(12)<<std::fixed<<std::setprecision(1)<<beacon_bytes/1000./std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+			         <<std::setw(12)<<requests<<std::endl;
+			last_beacons = beacons_sent;
+			next_report += std::chrono::seconds(1);
+		}
+		
+	}
+	
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	delete pipeline; // waits for outstanding requests
+	pipeline=nullptr;
+	for(DAQBackend* connection : connections) delete connection;
+	connections.clear();
+	for(SlowControlCollection* controls : connection_controls) delete controls;
+	connection_controls.clear();
+	running=false;
+	listen.join();
+	close(sender);
+	close(listener);
+	
+	std::cout<<std::setprecision(2)<<n_devices<<" devices over "<<elapsed<<" s: ";
+	if(convergence_s>=0) std::cout<<"discovery converged after "<<convergence_s<<" s";
+	else std::cout<<"discovery did NOT converge ("<<devices_heard<<" heard)";
+	std::cout<<", beacon load "<<beacons_sent/elapsed<<" msgs/s, "<<beacon_bytes/elapsed/1000.<<" kB/s ("<<beacons_heard<<" of "<<beacons_sent<<" heard)"<<std::endl;
+	if(request_ms){
+		std::sort(request_latencies.begin(), request_latencies.end());
+		size_t n = request_latencies.size();
+		std::cout<<"middleman fan-in: "<<n/elapsed<<" requests/s from "<<n_devices<<" devices over "<<n_connections<<" connections, "<<(n ? (100.*requests_failed)/n : 0)<<"% failed";
+		if(n) std::cout<<", latency p50 "<<request_latencies[n/2]<<" ms, p99 "<<request_latencies[std::min(n-1, (n*99)/100)]<<" ms";
+		std::cout<<std::endl;
+	}
+	
+	return 0;
+	
+}
@@ -1,6 +1,10 @@
 #include <iostream>
 #include <DAQInterface.h>
 #include <functional>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <unistd.h>
 
 using namespace ToolFramework;
 
@@ -10,11 +14,12 @@ std::string Check(int ok){
 
 const std::string Reset = "\033[39m";
 
-int main(){
+int main(int argc, char* argv[]){
 	
 	int verbose=1;
 	
 	std::string Interface_configfile = "./InterfaceConfig";
+	if(argc>1) Interface_configfile = argv[1]; // e.g. a copy with local_db set, to test without a central database
 	
 	DAQInterface DAQ_inter(Interface_configfile);
 	DAQ_inter.SetVerbose(true);
@@ -110,6 +115,13 @@ int main(){
 	ok = DAQ_inter.GetRunConfig(tmp, base_id, runmode_id);
 	if(!ok || verbose) std::cout<<"Get run config (by id): "<<Check(ok)<<" = "<<tmp<<Reset<<std::endl;
 	
+	if(verbose) std::cout<<"Getting test run config only if changed..."<<std::flush;
+	std::string run_config, run_config_hash;
+	bool changed=false;
+	ok = DAQ_inter.GetRunConfigIfChanged(run_config, base_id, runmode_id, run_config_hash, changed);
+	ok = ok && changed && DAQ_inter.GetRunConfigIfChanged(run_config, base_id, runmode_id, run_config_hash, changed) && !changed && run_config==tmp;
+	if(!ok || verbose) std::cout<<"Get run config (if changed): "<<Check(ok)<<" hash = "<<run_config_hash<<Reset<<std::endl;
+	
 	// N.B: this is not a full detector configuration
 	if(verbose) std::cout<<"Getting test runmode config by name & version..."<<std::flush;
 	ok = DAQ_inter.GetRunModeConfig(tmp, device_name, 0);
@@ -152,6 +164,58 @@ int main(){
 		std::cout<<Reset;
 	}
 	
+	if(verbose) std::cout<<"Testing columnar SQL query"<<Reset<<std::endl;
+	SQLResultSet result;
+	result.Declare("config_id", SQLColumnType::Int); // numbers are Float unless declared
+	ok = DAQ_inter.SQLQuery("SELECT config_id, name, version FROM base_config WHERE name='"+device_name+"'",result);
+	int id_col = result.ColumnIndex("config_id");
+	ok = ok && result.Rows()>0 && id_col>=0 && result.ColumnType(id_col)==SQLColumnType::Int && result.Ints(id_col).at(0)==base_id;
+	if(!ok || verbose) std::cout<<"Get typed result set via SQL: "<<Check(ok)<<", got "<<result.Rows()<<" rows, "<<result.Columns()<<" columns "<<result.Error()<<Reset<<std::endl;
+	
+	if(verbose) std::cout<<"Testing pipelined SQL queries"<<Reset<<std::endl;
+	std::vector<std::string> async_responses(10);
+	std::vector<std::future<bool> > async_results;
+	for(size_t i=0; i<async_responses.size(); ++i){
+		async_results.push_back(DAQ_inter.SQLQueryAsync("SELECT "+std::to_string(i)+" AS value", async_responses.at(i)));
+	}
+	ok = true;
+	for(size_t i=0; i<async_results.size(); ++i){
+		ok = async_results.at(i).get() && async_responses.at(i).find(std::to_string(i))!=std::string::npos && ok;
+	}
+	if(!ok || verbose) std::cout<<"Pipelined SQL queries: "<<Check(ok)<<Reset<<std::endl;
+	
+	if(verbose) std::cout<<"Reloading an unchanged configuration..."<<std::flush;
+	std::vector<std::string> restart_needed;
+	ok = DAQ_inter.ReloadConfig(&restart_needed) && restart_needed.empty();
+	ok = DAQ_inter.SQLQuery("SELECT 1 AS value",tmp) && ok; // and the connection still works
+	if(!ok || verbose) std::cout<<"Reload configuration: "<<Check(ok)<<Reset<<std::endl;
+	
+	if(verbose) std::cout<<"Reloading a changed configuration..."<<std::flush;
+	// changes go in a copy, so the real configuration file is never touched
+	std::string original_config;
+	{
+		std::ifstream in(Interface_configfile);
+		original_config.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+	std::string config_copy = (std::filesystem::temp_directory_path() / ("InterfaceConfig_test_"+std::to_string(getpid()))).string();
+	std::ofstream(config_copy, std::ios::trunc)<<original_config<<"\nrun_config_cache 1\nplot_cache_mb 1\n"; // one applied in place, one fixed at construction
+	ok = !DAQ_inter.ReloadConfig(&restart_needed, config_copy) && restart_needed==std::vector<std::string>{"plot_cache_mb"};
+	std::ofstream(config_copy, std::ios::trunc)<<original_config;
+	ok = DAQ_inter.ReloadConfig(&restart_needed) && restart_needed.empty() && ok; // back as it was
+	if(!ok || verbose) std::cout<<"Reload changed configuration: "<<Check(ok)<<Reset<<std::endl;
+	
+	if(verbose) std::cout<<"Reloading changed services settings..."<<std::flush;
+	// the network backend recreates its services in place; the others can't, and report the setting instead
+	std::ofstream(config_copy, std::ios::trunc)<<original_config<<"\nresend_period_ms 1500\n";
+	ok = DAQ_inter.ReloadConfig(&restart_needed) ? restart_needed.empty() : restart_needed==std::vector<std::string>{"resend_period_ms"};
+	ok = DAQ_inter.SQLQuery("SELECT 1 AS value",tmp) && ok; // the recreated services still work
+	std::ofstream(config_copy, std::ios::trunc)<<original_config;
+	ok = (DAQ_inter.ReloadConfig(&restart_needed) || restart_needed==std::vector<std::string>{"resend_period_ms"}) && ok;
+	ok = DAQ_inter.ReloadConfig(&restart_needed, Interface_configfile) && restart_needed.empty() && ok;
+	ok = DAQ_inter.SQLQuery("SELECT 1 AS value",tmp) && ok;
+	std::filesystem::remove(config_copy);
+	if(!ok || verbose) std::cout<<"Reload services settings: "<<Check(ok)<<Reset<<std::endl;
+	
 	if(verbose) std::cout<<"Sending bad SQL query ..."<<Reset<<std::endl;
 	ok = DAQ_inter.SQLQuery("SELECT potato, message FROM logging ORDER BY time DESC LIMIT 1",tmp);
 	if(!ok || verbose) std::cout<<"Running bad SQL query returned: "<<Check(ok)<<" = "<<tmp<<Reset<<std::endl;
@@ -37,7 +37,7 @@ int main(){
     struct sockaddr_in addr;
     int addrlen, sock, cnt;
     struct ip_mreq mreq;
-    char message[512];
+    static char message[65536]; // a whole UDP datagram, so larger messages and fragments aren't truncated
     
     // set up socket //
     sock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -86,9 +86,9 @@ int main(){
       if ((cnt > 0) ) {
 	
 
-	zmq::message_t MM_message(sizeof(message));
+	zmq::message_t MM_message(cnt);
 	
-	memcpy( MM_message.data(), message, sizeof(message));
+	memcpy( MM_message.data(), message, cnt);
 	//	snprintf ((char *) MM_message.data(), sizeof(message) , "%d" , message) ;	
 	publish_sock_MM.send(MM_message);
 
@@ -0,0 +1,63 @@
+#ifndef AGENT_BACKEND_H
+#define AGENT_BACKEND_H
+
+#include <map>
+#include <atomic>
+#include <DAQBackend.h>
+#include <SharedMemoryRing.h>
+#include <JsonUtils.h>
+
+namespace ToolFramework {
+  
+  /* Client side of the node-local agent (see DAQAgent.cpp): all traffic is handed to the agent through a
+     shared memory ring instead of this process opening its own discovery beacon, services and multicast
+     sockets. Logs and monitoring are one-way; everything else is a request answered in place.
+     Requests are encoded as flat JSON objects with a "call" field naming the DAQInterface function.
+     Critical alarms go through the agent's priority ring when it has one, bypassing bulk traffic.
+     Every request carries an absolute 'deadline' (ms since the epoch) derived from its timeout. */
+  
+  class AgentBackend : public DAQBackend{
+    
+  public:
+    
+    AgentBackend(const std::string& device_name);
+    
+    bool Connect(const std::string& ring_name);
+    
+    unsigned long TimedOut(); // requests given up on; the agent drops their replies, or skips them if it hasn't started
+    
+    bool SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout);
+    bool SQLQuery(const std::string& query, std::string& response, const unsigned int timeout);
+    bool SQLQuery(const std::string& query, const unsigned int timeout);
+    bool SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp);
+    bool SendAlarm(const std::string& message, bool critical, const std::string& device, const uint64_t timestamp, const unsigned int timeout);
+    bool SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp);
+    bool SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout);
+    bool GetCalibrationData(std::string& json_data, int& version, const std::string& device, const unsigned int timeout);
+    bool SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout);
+    bool GetDeviceConfig(std::string& json_data, const int version, const std::string& device, const unsigned int timeout);
+    bool GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout);
+    bool GetRunModeConfig(std::string& json_data, const std::string& name, const int version, const unsigned int timeout);
+    bool GetRunDeviceConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, int* version, const unsigned int timeout);
+    bool SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int& version, const unsigned int timeout);
+    bool SendPlotlyPlot(const std::string& name, const std::string& json_trace, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool SendPlotlyPlot(const std::string& name, const std::vector<std::string>& json_traces, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int& version, const unsigned int timeout);
+    
+  private:
+    
+    bool Call(JsonUtils::Writer& request, std::map<std::string, std::string>& reply, std::string& error, const unsigned int timeout, const bool priority=false); // adds the deadline and sends request, leaving it empty
+    const std::string& Device(const std::string& device);
+    
+    SharedMemoryRing m_ring;
+    SharedMemoryRing m_priority_ring;
+    bool m_has_priority_ring=false;
+    std::string m_device_name;
+    std::atomic<unsigned long> m_timed_out;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef CALL_TRACE_H
+#define CALL_TRACE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+namespace ToolFramework {
+  
+  enum class TraceCall : uint8_t { SQLQuery=1, SendLog, SendAlarm, SendMonitoringData, SendCalibrationData, GetCalibrationData, SendDeviceConfig, GetDeviceConfig, GetRunConfig, GetRunModeConfig, GetRunDeviceConfig, SendROOTplot, GetROOTplot, SendPlotlyPlot, GetPlotlyPlot };
+  
+  const char* TraceCallName(const TraceCall call);
+  
+  struct TraceRecord{
+    uint64_t time_us;       // call start, relative to the start of the trace
+    uint32_t request_bytes; // payload sent
+    uint32_t reply_bytes;   // payload received
+    uint32_t timeout_ms;    // 0 for fire-and-forget calls
+    uint32_t latency_us;
+    TraceCall call;
+    uint8_t ok;
+    uint8_t reserved[6];
+  };
+  
+  /* Compact binary record of a session's backend calls (see TracingBackend): an 8 byte magic, the wall clock
+     start time in us since the epoch, then one fixed size TraceRecord per call in completion order. Payloads
+     themselves are not kept, only their sizes. */
+  
+  class CallTrace{
+    
+  public:
+    
+    CallTrace();
+    ~CallTrace();
+    
+    bool Open(const std::string& path); // for writing, truncates
+    void Record(const TraceCall call, const std::chrono::steady_clock::time_point start, const size_t request_bytes, const size_t reply_bytes, const unsigned int timeout_ms, const bool ok);
+    void Close();
+    
+    static bool Read(const std::string& path, std::vector<TraceRecord>& records, uint64_t* start_epoch_us=nullptr);
+    
+  private:
+    
+    std::ofstream m_file;
+    std::chrono::steady_clock::time_point m_start;
+    std::mutex m_mtx;
+    
+  };
+  
+}
+
+#endif
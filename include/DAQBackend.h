@@ -0,0 +1,47 @@
+#ifndef DAQ_BACKEND_H
+#define DAQ_BACKEND_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <Services.h>
+
+namespace ToolFramework {
+  
+  // transport behind DAQInterface: the network services stack, or a node-local agent.
+  // signatures mirror the corresponding Services calls.
+  
+  class DAQBackend{
+    
+  public:
+    
+    virtual ~DAQBackend(){};
+    
+    virtual bool SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout)=0;
+    virtual bool SQLQuery(const std::string& query, std::string& response, const unsigned int timeout)=0;
+    virtual bool SQLQuery(const std::string& query, const unsigned int timeout)=0;
+    virtual bool Probe(const std::string& query, std::string& response, const unsigned int timeout){ return SQLQuery(query, response, timeout); } // optional lookup the caller can do without; not counted as a failed request
+    
+    virtual bool SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp)=0;
+    virtual bool SendAlarm(const std::string& message, bool critical, const std::string& device, const uint64_t timestamp, const unsigned int timeout)=0;
+    virtual bool SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp)=0;
+    virtual bool SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout)=0;
+    virtual bool GetCalibrationData(std::string& json_data, int& version, const std::string& device, const unsigned int timeout)=0;
+    virtual bool SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout)=0;
+    virtual bool GetDeviceConfig(std::string& json_data, const int version, const std::string& device, const unsigned int timeout)=0;
+    virtual bool GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout)=0;
+    virtual bool GetRunModeConfig(std::string& json_data, const std::string& name, const int version, const unsigned int timeout)=0;
+    virtual bool GetRunDeviceConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, int* version, const unsigned int timeout)=0;
+    virtual bool SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout)=0;
+    virtual bool GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int& version, const unsigned int timeout)=0;
+    virtual bool SendPlotlyPlot(const std::string& name, const std::string& json_trace, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout)=0;
+    virtual bool SendPlotlyPlot(const std::string& name, const std::vector<std::string>& json_traces, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout)=0;
+    virtual bool GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int& version, const unsigned int timeout)=0;
+    
+    virtual bool Reload(Store& vars){ return false; } // apply a re-read configuration in place; false if the transport's settings can't change without a restart
+    
+  };
+  
+}
+
+#endif
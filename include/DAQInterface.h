@@ -8,6 +8,11 @@
 #include <thread>
 #include <chrono>
 #include <functional>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <tuple>
 #include <SlowControlCollection.h>
 //#include <boost/uuid/uuid.hpp>             //uuid class
 //#include <boost/uuid/uuid_generators.hpp>  //generators
@@ -15,6 +20,24 @@
 //#include <boost/date_time/posix_time/posix_time.hpp>
 //#include <boost/progress.hpp>
 #include <Services.h>
+#include <DAQBackend.h>
+#include <NetworkBackend.h>
+#include <AgentBackend.h>
+#include <StandInBackend.h>
+#include <LocalDBBackend.h>
+#include <TracingBackend.h>
+#include <SpanTracer.h>
+#include <MonitoringAggregator.h>
+#include <MonitoringSchema.h>
+#include <RequestPipeline.h>
+#include <MulticastSender.h>
+#include <SQLResultSet.h>
+#include <SQLInsertBuilder.h>
+#include <ReliableLogger.h>
+#include <UploadDeduplicator.h>
+#include <PlotCache.h>
+#include <SlowControlChangeLog.h>
+#include <SlowControlHistory.h>
 
 namespace {
   const unsigned int default_timeout=300;
@@ -22,6 +45,32 @@ namespace {
 
 namespace ToolFramework {
   
+  // one key of a multi-device fetch, and its result
+  struct DeviceData{
+    std::string device; // "" for this device
+    int version=-1;     // -1 for the latest; set to the version found
+    std::string json_data;
+    bool ok=false;
+    std::string error;
+  };
+  
+  /* Thread safety: all public member functions may be called concurrently from any number of threads.
+     - SendLog / SendMonitoringData / RecordMonitoringValue are lock-free on the caller's side (see MulticastSender
+       and MonitoringAggregator); the multicast sockets are only driven by one sender thread.
+     - request/reply calls go through the services backend, which matches replies to callers by message id,
+       so concurrent calls proceed in parallel rather than queueing behind each other.
+     - slow control registration through this class (Add/Remove/Clear...) is serialised internally, and so are
+       the value accessors (Get/SetSlowControlValue, WithSlowControlVariable). A pointer from
+       GetSlowControlVariable is not protected once returned, and direct structural changes on the public
+       sc_vars member should not race with any of these.
+     - the WithSlowControlVariable callback runs holding that lock. It may call the slow control members of this
+       class from the same thread, but must not remove the control it was given, and must not wait on another
+       thread that uses them (e.g. joining a thread that calls SetSlowControlValue): that deadlocks.
+     
+     With 'local_agent <ring name>' in the configuration file, all traffic is handed to a DAQAgent process on the
+     same node through shared memory, and this process opens no sockets of its own. Slow controls are not served
+     in that mode, since the process is not individually reachable, so adding one fails. */
+  
   class DAQInterface{
     
   public:
@@ -32,18 +81,34 @@ namespace ToolFramework {
     bool SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout=default_timeout);
     bool SQLQuery(const std::string& query, std::string& response, const unsigned int timeout=default_timeout);
     bool SQLQuery(const std::string& query, const unsigned int timeout=default_timeout);
+    bool SQLQuery(const std::string& query, SQLResultSet& result, const unsigned int timeout=default_timeout); // typed columnar results, query must return rows (SELECT or ... RETURNING)
+    bool SQLBulkInsert(const std::string& table, const std::vector<std::string>& columns, const std::vector<SQLRow>& rows, std::vector<std::string>* batch_errors=nullptr, const unsigned int batch_size=1000, const unsigned int timeout=default_timeout); // one statement per batch, batch_errors gets one entry per batch ("" on success)
     
     bool SendLog(const std::string& message, LogLevel severity=LogLevel::Message, const std::string& device="", const uint64_t timestamp=0); //serverity levels are 0 = critical, 1 = Error, 2 = warning, 3= info , 4-9 debug
+    bool SendLog(std::string&& message, LogLevel severity=LogLevel::Message, const std::string& device="", const uint64_t timestamp=0); // rvalue payloads are moved through to the sender thread without a copy
+    bool SendLogReliable(const std::string& message, LogLevel severity=LogLevel::Message, const std::string& device="", const uint64_t timestamp=0); // acknowledged and never dropped, needs 'reliable_logging 1'; false only if it could be neither queued nor spooled
+    ReliableLogger* GetReliableLogger(); // nullptr unless 'reliable_logging 1'
+    UploadDeduplicator* GetUploadDeduplicator(); // hit counters for skipped identical uploads, nullptr unless 'upload_dedup 1'
     bool SendAlarm(const std::string& message, bool critical=false, const std::string& device="", const uint64_t timestamp=0, const unsigned int timeout=default_timeout);
     bool SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device="", const uint64_t timestamp=0);
+    bool SendMonitoringData(std::string&& json_data, const std::string& subject, const std::string& device="", const uint64_t timestamp=0);
+    bool RecordMonitoringValue(const std::string& subject, const std::string& field, const double value); // reduced over 'monitoring_window_ms' and sent once per window
+    MonitoringAggregator* GetMonitoringAggregator(); // for registering handles to record against on the hot path
+    uint32_t RegisterMonitoringSchema(const std::string& subject, const std::vector<std::pair<std::string, SchemaFieldType> >& fields); // fixed layout for SendMonitoringValues, see MonitoringSchema; 0 if it can't be registered
+    bool SendMonitoringValues(const uint32_t schema_id, const std::vector<double>& values); // values only, in registered order
+    MonitoringSchema* GetMonitoringSchema();
     bool SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device="", const uint64_t timestamp=0, int* version=nullptr, const unsigned int timeout=default_timeout);
     bool GetCalibrationData(std::string& json_data, int& version, const std::string& device="", const unsigned int timeout=default_timeout);
     bool GetCalibrationData(std::string& json_data, int&& version=-1, const std::string& device="", const unsigned int timeout=default_timeout);
     bool SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device="", const uint64_t timestamp=0, int* version=nullptr, const unsigned int timeout=default_timeout);
     bool GetDeviceConfig(std::string& json_data, const int version, const std::string& device="", const unsigned int timeout=default_timeout);
+    bool GetCalibrationData(std::vector<DeviceData>& items, const unsigned int timeout=default_timeout); // all devices in one go: one pipelined request per device, each with its own timeout (one round trip only with 'multi_device_query 1'); true if every item succeeded, see DeviceData::error otherwise
+    bool GetDeviceConfig(std::vector<DeviceData>& items, const unsigned int timeout=default_timeout);
     bool GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout=default_timeout);
     bool GetRunModeConfig(std::string& json_data, const std::string& name, const int version, const unsigned int timeout=default_timeout);
     bool GetDeviceConfigFromRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device="", const unsigned int timeout=default_timeout);
+    bool GetRunConfigIfChanged(std::string& json_data, const int base_config_id, const int runmode_config_id, std::string& hash, bool& changed, const unsigned int timeout=default_timeout); // json_data and hash are only updated if the config no longer matches hash; without run_config_cache the config is fetched to compare
+    void ClearRunConfigCache();
     //bool GetDeviceConfigFromRunConfig(std::string& json_data, const std::string& runconfig_name, const int runconfig_version, const std::string& device="", const unsigned int timeout=default_timeout);
     bool SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version=nullptr, const uint64_t timestamp=0, const unsigned int lifetime=5, const unsigned int timeout=default_timeout);
     bool GetROOTplot(const std::string& plot_name, std::string& draw_option, std::string& json_data, int& version, const unsigned int timeout=default_timeout);
@@ -52,10 +117,44 @@ namespace ToolFramework {
     bool SendPlotlyPlot(const std::string& name, const std::vector<std::string>& json_traces, const std::string& json_layout="{}", int* version=nullptr, const uint64_t timestamp=0, const unsigned int lifetime=5, unsigned int timeout=default_timeout);
     bool GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int& version, unsigned int timeout=default_timeout);
     bool GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int&& version=-1, unsigned int timeout=default_timeout);
+    // fetches through the plot cache like GetROOTplot, and also caches the object 'parse' makes from the json,
+    // e.g. [](const std::string& json){ return TBufferJSON::FromJSON<TH1D>(json.c_str()).release(); }
+    template<typename T> std::shared_ptr<const T> GetParsedROOTplot(const std::string& plot_name, std::string& draw_options, int& version, std::function<T*(const std::string& json_data)> parse, const unsigned int timeout=default_timeout){
+      std::string json_data;
+      if(!GetROOTplot(plot_name, draw_options, json_data, version, timeout)) return nullptr;
+      if(!m_plot_cache) return std::shared_ptr<const T>(parse(json_data));
+      std::shared_ptr<const T> parsed = m_plot_cache->GetParsed<T>("root_plot:"+plot_name, version);
+      if(parsed) return parsed;
+      parsed.reset(parse(json_data));
+      if(parsed) m_plot_cache->SetParsed<T>("root_plot:"+plot_name, version, parsed, json_data.size());
+      return parsed;
+    }
+    PlotCache* GetPlotCache(); // nullptr if 'plot_cache_mb 0'
+    
+    // pipelined versions of the request/reply calls: these return at once, with up to 'max_in_flight' requests
+    // outstanding and completing out of order. Output arguments must remain valid until the future is ready.
+    std::future<bool> SQLQueryAsync(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout=default_timeout);
+    std::future<bool> SQLQueryAsync(const std::string& query, std::string& response, const unsigned int timeout=default_timeout);
+    std::future<bool> GetCalibrationDataAsync(std::string& json_data, int& version, const std::string& device="", const unsigned int timeout=default_timeout);
+    std::future<bool> GetDeviceConfigAsync(std::string& json_data, const int version, const std::string& device="", const unsigned int timeout=default_timeout);
+    std::future<bool> GetRunConfigAsync(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout=default_timeout);
+    std::future<bool> GetDeviceConfigFromRunConfigAsync(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device="", const unsigned int timeout=default_timeout);
+    // uploads hold their payload until sent, so take it by value: std::move a large one in to queue it without a copy
+    std::future<bool> SendCalibrationDataAsync(std::string json_data, const std::string& description, const std::string& device="", const uint64_t timestamp=0, int* version=nullptr, const unsigned int timeout=default_timeout);
+    std::future<bool> SendDeviceConfigAsync(std::string json_data, const std::string& author, const std::string& description, const std::string& device="", const uint64_t timestamp=0, int* version=nullptr, const unsigned int timeout=default_timeout);
+    std::future<bool> SendROOTplotAsync(const std::string& plot_name, const std::string& draw_options, std::string json_data, int* version=nullptr, const uint64_t timestamp=0, const unsigned int lifetime=5, const unsigned int timeout=default_timeout);
+    std::future<bool> SendPlotlyPlotAsync(const std::string& name, std::string json_trace, const std::string& json_layout="{}", int* version=nullptr, const uint64_t timestamp=0, const unsigned int lifetime=5, const unsigned int timeout=default_timeout);
+    std::future<bool> SendPlotlyPlotAsync(const std::string& name, std::vector<std::string> json_traces, const std::string& json_layout="{}", int* version=nullptr, const uint64_t timestamp=0, const unsigned int lifetime=5, const unsigned int timeout=default_timeout);
+    RequestPipeline* GetRequestPipeline();
+    MulticastSender* GetMulticastSender();
+    SpanTracer* GetSpanTracer(); // nullptr unless 'span_trace_file' is set
     
     SlowControlCollection* GetSlowControlCollection();
-    SlowControlElement* GetSlowControlVariable(std::string key);
+    SlowControlElement* GetSlowControlVariable(std::string key); // only valid until the control is removed; where controls come and go, use the calls below
+    bool WithSlowControlVariable(const std::string& name, const std::function<void(SlowControlElement&)>& function); // runs function on the control while it can't be removed; false if there's none
     bool AddSlowControlVariable(std::string name, SlowControlElementType type, std::function<std::string(const char*)> change_function=nullptr, std::function<std::string(const char*)> read_function=nullptr);
+    bool AddSlowControlVariables(const std::string& json_spec, const std::map<std::string, std::function<std::string(const char*)> >& callbacks={}); // register a whole set of controls at once, see below
+    bool AddSlowControlVariables(Store& spec, const std::map<std::string, std::function<std::string(const char*)> >& callbacks={});
     bool RemoveSlowControlVariable(std::string name);
     void ClearSlowControlVariables();
     
@@ -63,23 +162,101 @@ namespace ToolFramework {
     bool AlertSend(std::string alert, std::string payload);
     
     std::string PrintSlowControlVariables();
+    bool GetSlowControlChanges(std::string& json_data, const uint64_t since_version=0); // only the controls changed since a version returned by a previous call, see SlowControlChangeLog
+    bool EnableSlowControlHistory(const std::string& name, const size_t samples=600); // keep the last 'samples' values of a numeric control, one per 'sc_history_period_ms'
+    SlowControlHistory* GetSlowControlHistory(); // range and summary queries over the kept values
     std::string GetDeviceName();
     void SetVerbose(bool in);
+    bool ReloadConfig(std::vector<std::string>* restart_needed=nullptr, const std::string& configuration_file=""); // re-read the configuration file, or switch to another, and apply what changed in place, see below
     
     template<typename T> T GetSlowControlValue(std::string name){
-      return sc_vars[name]->GetValue<T>();
+      std::lock_guard<std::recursive_mutex> lock(m_sc_mtx);
+      SlowControlElement* element = sc_vars[name];
+      return element ? element->GetValue<T>() : T();
+    }
+    template<typename T> bool GetSlowControlValue(const std::string& name, T& value){ // false if there's no such control
+      std::lock_guard<std::recursive_mutex> lock(m_sc_mtx);
+      SlowControlElement* element = sc_vars[name];
+      return element && element->GetValue<T>(value);
+    }
+    template<typename T> bool SetSlowControlValue(const std::string& name, const T value){
+      std::lock_guard<std::recursive_mutex> lock(m_sc_mtx);
+      SlowControlElement* element = sc_vars[name];
+      return element && element->SetValue(value);
     }
     
     SlowControlCollection sc_vars;
     
+    /* AddSlowControlVariables spec format: a JSON object keyed by control name, e.g.
+       { "voltage_1":{ "type":"VARIABLE", "min":0, "max":5000, "step":0.1, "value":3500.5, "callback":"voltage_change" },
+         "power_on":{ "type":"OPTIONS", "options":["1","0"], "value":"0" },
+         "Start":{ "type":"BUTTON", "value":false, "callback":"start" } }
+       'callback' and 'read_callback' name entries in the callbacks map passed alongside the spec.
+       The whole spec is validated before anything is registered; if any control fails to register,
+       those already added by the call are removed again and false is returned. */
+    
+    /* ReloadConfig applies, without disturbing anything else: verbosity, run_config_cache, probe_timeout_ms,
+       plot_version_probe, multi_device_query, monitoring_window_ms, reliable_log_severity, the
+       service_discovery_* settings (discovery restarts) and the services settings such as ports, addresses,
+       timeouts and resend_period_ms (the services are recreated on the existing ZMQ context once calls in
+       progress finish; slow control registrations are kept). Settings fixed at
+       construction (device_name, queue sizes, caches, tracing, backend choice...) keep their old values; they
+       are listed in 'restart_needed' if they changed, and the call returns false. So are services and discovery
+       settings when the backend can't apply them in place (local agent, stand-in, local database).
+       Given a configuration_file, it reads that one instead, and so do later reloads that don't name a file. */
+    
   private:
 
-    Services* m_services;
-    zmq::context_t* m_context=nullptr;
-    ServiceDiscovery* mp_SD;
+    DAQBackend* m_backend=nullptr;
+    MonitoringAggregator* m_aggregator=nullptr;
+    MonitoringSchema* m_monitoring_schema=nullptr;
+    RequestPipeline* m_pipeline=nullptr;
+    MulticastSender* m_multicast=nullptr;
+    ReliableLogger* m_reliable_logger=nullptr;
+    SpanTracer* m_span_tracer=nullptr;
+    PlotCache* m_plot_cache=nullptr; // fetched plots by version; "latest" is only served from it with plot_version_probe
+    struct ProbeState{ // an optional lookup: off for good once the database rejects its schema, backed off after other failures
+      std::atomic<bool> enabled;
+      std::atomic<unsigned int> failures=0; // consecutive transient failures; each doubles the backoff
+      std::atomic<int64_t> retry_at_ms=0; // steady clock, skipped until then
+      ProbeState(const bool on) : enabled(on){}
+      void Reset(const bool on){ failures=0; retry_at_ms=0; enabled=on; }
+    };
+    ProbeState m_plot_version_probe{true}; // one-row max(version) query on the plot tables; a database without them switches it off at the first reply
+    std::string m_root_plot_table="rootplots";
+    std::string m_plotly_plot_table="plotlyplots";
+    bool LatestPlotVersion(const std::string& table, const std::string& name, int& version, const unsigned int timeout);
+    std::string m_calibration_table="calibration";
+    std::string m_device_config_table="device_config";
+    bool GetDeviceDataMulti(const std::string& table, std::vector<DeviceData>& items, const bool config, const unsigned int timeout);
+    bool GetDeviceDataQuery(const std::string& table, std::vector<DeviceData>& items, const bool config, const unsigned int timeout); // single PostgreSQL query that assumes the table layout
+    std::atomic<bool> m_multi_device_query=false;
+    UploadDeduplicator* m_dedup=nullptr; // skips byte-identical re-uploads of plots, calibration data and device configs
+    std::atomic<int> m_reliable_log_severity=-1; // SendLog routes severities up to this through m_reliable_logger
     Store vars;
+    std::string m_configuration_file;
+    std::mutex m_reload_mtx;
     std::string m_name;
-    bool m_verbose;
+    std::atomic<bool> m_verbose=false;
+    bool m_local_agent=false; // slow controls can't be reached through the agent
+    std::recursive_mutex m_sc_mtx; // serialises structural changes to sc_vars; recursive so WithSlowControlVariable callbacks can use the accessors
+    SlowControlChangeLog m_sc_changelog;
+    SlowControlHistory* m_sc_history=nullptr;
+    
+    // merged run configs are cached by (base_config_id, runmode_config_id[, device]) alongside a hash of the
+    // underlying configs; each use costs one small probe query, and the full fetch only happens on a change.
+    // The probe assumes the base_config/runmode_config schema, so it's off by default and switches itself
+    // off for good after the first reply showing the database doesn't fit it (a missing table or column);
+    // other failures back off from 1 s up to a minute and then try again.
+    bool GetRunConfigHash(const int base_config_id, const int runmode_config_id, std::string& hash, const unsigned int timeout);
+    bool FetchRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& hash, const unsigned int timeout); // empty hash bypasses the cache
+    std::atomic<bool> m_run_config_cache_enabled=false;
+    ProbeState m_run_config_probe{true};
+    std::atomic<unsigned int> m_probe_timeout_ms=250; // probes are cheap lookups; don't wait the caller's full timeout on them
+    bool ProbeQuery(const std::string& query, std::string& response, const unsigned int timeout, ProbeState& probe);
+    std::map<std::pair<int, int>, std::pair<std::string, std::string> > m_run_config_cache; // -> (hash, json)
+    std::map<std::tuple<int, int, std::string>, std::pair<std::string, std::string> > m_run_device_config_cache;
+    std::mutex m_run_config_cache_mtx;
     
     
   };
@@ -10,6 +10,27 @@
 #pragma link C++ namespace ToolFramework;
 //#pragma link C++ defined_in DAQInterface;
 #pragma link C++ class ToolFramework::DAQInterface;
+#pragma link C++ struct ToolFramework::DeviceData;
+#pragma link C++ class ToolFramework::MonitoringAggregator;
+#pragma link C++ class ToolFramework::MonitoringSchema;
+#pragma link C++ enum ToolFramework::SchemaFieldType;
+#pragma link C++ class ToolFramework::RequestPipeline;
+#pragma link C++ class ToolFramework::MulticastSender;
+#pragma link C++ class ToolFramework::FragmentReassembler;
+#pragma link C++ class ToolFramework::SQLResultSet;
+#pragma link C++ enum ToolFramework::SQLColumnType;
+#pragma link C++ class ToolFramework::SQLInsertBuilder;
+#pragma link C++ class ToolFramework::ReliableLogger;
+#pragma link C++ class ToolFramework::UploadDeduplicator;
+#pragma link C++ class ToolFramework::PlotCache;
+#pragma link C++ class ToolFramework::SlowControlChangeLog;
+#pragma link C++ class ToolFramework::SlowControlHistory;
+#pragma link C++ class ToolFramework::SampleRing;
+#pragma link C++ struct ToolFramework::SampleSummary;
+#pragma link C++ class ToolFramework::CallTrace;
+#pragma link C++ class ToolFramework::SpanTracer;
+#pragma link C++ struct ToolFramework::TraceRecord;
+#pragma link C++ enum ToolFramework::TraceCall;
 //#pragma link C++ defined_in namespace ToolFramework;
 
 #endif
@@ -0,0 +1,61 @@
+#ifndef FRAGMENT_REASSEMBLER_H
+#define FRAGMENT_REASSEMBLER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <chrono>
+#include <mutex>
+#include <cstdint>
+
+namespace ToolFramework {
+  
+  /* Multicast logs and monitoring data are single datagrams, so long payloads are split by Split() into
+     {"fragment":"<id>","index":i,"count":n,"data":"<part>"} messages cut on UTF-8 character boundaries, each no
+     bigger than max_bytes once escaped again as the JSON string of the log or monitoring message carrying it.
+     Each fragment is valid JSON on its own, so relays and stores that don't reassemble still see well formed
+     messages.
+     A receiver passes every message to Add(); whole messages come straight back out, fragments are held
+     until the last one arrives. Partial messages are dropped after 'timeout_ms', and the oldest are dropped
+     first once more than 'max_bytes' are buffered, so a lost fragment never pins memory. */
+  
+  class FragmentReassembler{
+    
+  public:
+    
+    FragmentReassembler(const size_t max_bytes=16*1024*1024, const unsigned int timeout_ms=5000);
+    
+    static bool Split(const std::string& payload, const size_t max_bytes, const uint64_t id, std::vector<std::string>& fragments); // false if it fits as is
+    static bool IsFragment(const std::string& message);
+    
+    bool Add(const std::string& source, const std::string& message, std::string& payload); // true when 'payload' holds a complete message
+    
+    unsigned long Reassembled();
+    unsigned long Expired(); // partial messages given up on
+    size_t Pending();
+    
+  private:
+    
+    struct Partial{
+      std::vector<std::string> parts;
+      size_t received=0;
+      size_t bytes=0;
+      std::chrono::steady_clock::time_point started;
+    };
+    
+    void Expire(const std::chrono::steady_clock::time_point now);
+    
+    const size_t m_max_bytes;
+    const std::chrono::milliseconds m_timeout;
+    std::map<std::pair<std::string, std::string>, Partial> m_partials; // by (source, id)
+    size_t m_bytes;
+    unsigned long m_reassembled;
+    unsigned long m_expired;
+    std::mutex m_mtx;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef JSON_UTILS_H
+#define JSON_UTILS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+namespace ToolFramework {
+  
+  // lightweight helpers for splitting JSON documents without building a Store per element.
+  // values are returned as raw JSON text (strings keep their quotes, objects/arrays their brackets)
+  namespace JsonUtils {
+    
+    bool SplitObject(std::string_view json, std::vector<std::pair<std::string, std::string_view> >& members);
+    bool SplitArray(std::string_view json, std::vector<std::string_view>& elements);
+    
+    std::string Unquote(std::string_view value); // JSON string literal -> plain string (other values returned trimmed)
+    std::string Quote(std::string_view value);   // plain string -> escaped JSON string literal
+    void AppendQuoted(std::string& out, std::string_view value, const size_t slack=0); // Quote onto the end of out; if out must grow, 'slack' extra bytes are reserved for what follows
+    
+    bool IsString(std::string_view value);
+    bool IsNull(std::string_view value);
+    std::string_view Trim(std::string_view value);
+    
+    // builds a flat JSON object
+    class Writer{
+      
+    public:
+      
+      Writer& AddString(const std::string& key, std::string_view value);
+      Writer& AddNumber(const std::string& key, const int64_t value);
+      Writer& AddBool(const std::string& key, const bool value);
+      Writer& AddStrings(const std::string& key, const std::vector<std::string>& values);
+      Writer& AddRaw(const std::string& key, std::string_view json);
+      std::string str() const;
+      std::string Take(); // str() without copying the text; leaves the writer empty
+      
+    private:
+      
+      void Key(const std::string& key);
+      std::string m_json;
+      
+    };
+    
+  }
+  
+}
+
+#endif
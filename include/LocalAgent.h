@@ -0,0 +1,63 @@
+#ifndef LOCAL_AGENT_H
+#define LOCAL_AGENT_H
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include <DAQInterface.h>
+#include <SharedMemoryRing.h>
+#include <RequestPipeline.h>
+
+namespace ToolFramework {
+  
+  /* Agent side of the node-local ring (see AgentBackend): drains traffic from every client process on the
+     node and replays it through one DAQInterface, which holds the only network connections.
+     Logs and monitoring go straight onto that interface's multicast queue; requests are served by a pool of
+     'workers' threads so one slow query doesn't hold up the rest.
+     Critical alarms arrive on a second, small ring ('<ring name>_priority') with its own thread, so they are
+     never queued behind bulk requests that are holding main ring slots or busy workers.
+     Requests whose client has given up, or whose deadline has passed, are dropped unserved; the rest
+     are served within what remains of their deadline, so the work upstream stops when the client stops waiting.
+     Both threads reclaim slots left behind by dead clients every 100 ms (see SharedMemoryRing::Reclaim). */
+  
+  class LocalAgent{
+    
+  public:
+    
+    LocalAgent(DAQInterface* daq, const unsigned int workers=8);
+    ~LocalAgent();
+    
+    bool Start(const std::string& ring_name, const uint32_t slots=1024, const uint32_t slot_size=16384, const uint32_t priority_slots=16);
+    void Stop();
+    
+    unsigned long Messages();
+    unsigned long Requests();
+    unsigned long PriorityRequests();
+    unsigned long Expired(); // requests skipped because the client's deadline had passed or it had given up
+    unsigned long LateReplies(); // requests served, but after the client had given up
+    unsigned long Reclaimed(); // slots taken back from clients that died or stalled holding them
+    
+  private:
+    
+    void Thread();
+    void PriorityThread();
+    bool Dispatch(const std::string& request, std::string& reply);
+    
+    DAQInterface* m_daq;
+    SharedMemoryRing m_ring;
+    SharedMemoryRing m_priority_ring;
+    RequestPipeline m_pipeline;
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+    std::thread m_priority_thread;
+    std::atomic<unsigned long> m_messages;
+    std::atomic<unsigned long> m_requests;
+    std::atomic<unsigned long> m_priority_requests;
+    std::atomic<unsigned long> m_expired;
+    std::atomic<unsigned long> m_late_replies;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef LOCAL_DB_BACKEND_H
+#define LOCAL_DB_BACKEND_H
+
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <variant>
+#include <DAQBackend.h>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace ToolFramework {
+  
+  /* Serves the whole API from an embedded SQLite database file, for test stands and remote sites with no
+     central database or middleman ('local_db <file>' in the configuration file). Tables are created on first
+     open with the same names and columns as the central database, so plain SQL written for it mostly works
+     here too; PostgreSQL-only queries fail and DAQInterface falls back to its per-call paths where it has them.
+     Versions are numbered per device or plot name from 0, as centrally. An SQLQuery still running when
+     its timeout passes is interrupted rather than left to finish for nobody.
+     With a 'central' backend, every write is also queued in an outbox table and replayed to it each
+     'sync_period_s', oldest first, stopping at the first failure to keep the order. The central database
+     assigns its own versions on replay; SQLQuery writes are not synced. */
+  
+  class LocalDBBackend : public DAQBackend{
+    
+  public:
+    
+    LocalDBBackend(const std::string& device_name, DAQBackend* central=nullptr, const unsigned int sync_period_s=60); // takes ownership of central
+    ~LocalDBBackend();
+    
+    bool Open(const std::string& file, std::string& error);
+    
+    bool Sync(); // replays the outbox now; true once it's empty
+    unsigned long Synced();
+    unsigned long Unsynced(); // writes still in the outbox
+    unsigned long Cancelled(); // queries interrupted at their timeout
+    
+    bool SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout);
+    bool SQLQuery(const std::string& query, std::string& response, const unsigned int timeout);
+    bool SQLQuery(const std::string& query, const unsigned int timeout);
+    bool SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp);
+    bool SendAlarm(const std::string& message, bool critical, const std::string& device, const uint64_t timestamp, const unsigned int timeout);
+    bool SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp);
+    bool SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout);
+    bool GetCalibrationData(std::string& json_data, int& version, const std::string& device, const unsigned int timeout);
+    bool SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout);
+    bool GetDeviceConfig(std::string& json_data, const int version, const std::string& device, const unsigned int timeout);
+    bool GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout);
+    bool GetRunModeConfig(std::string& json_data, const std::string& name, const int version, const unsigned int timeout);
+    bool GetRunDeviceConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, int* version, const unsigned int timeout);
+    bool SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int& version, const unsigned int timeout);
+    bool SendPlotlyPlot(const std::string& name, const std::string& json_trace, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool SendPlotlyPlot(const std::string& name, const std::vector<std::string>& json_traces, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int& version, const unsigned int timeout);
+    
+    bool Reload(Store& vars);
+    
+  private:
+    
+    typedef std::variant<int64_t, std::string> Value;
+    
+    bool Run(const std::string& sql, const std::vector<Value>& values, std::string& error, const std::function<void(sqlite3_stmt*)>& row=nullptr, const unsigned int timeout=0); // caller holds m_db_mtx
+    bool Insert(const std::string& table, const std::vector<std::string>& columns, const std::vector<Value>& values, const bool versioned, int* version, const std::string& outbox);
+    bool Select(const std::string& sql, const std::vector<Value>& values, std::vector<std::string>& columns, std::string& error);
+    const std::string& Device(const std::string& device);
+    bool Replay(const std::string& method, const std::string& args);
+    void SyncThread();
+    
+    std::string m_device_name;
+    sqlite3* m_db;
+    std::mutex m_db_mtx; // one connection; SQLite serialises writers anyway
+    
+    DAQBackend* m_central;
+    std::atomic<unsigned int> m_sync_period_s;
+    std::mutex m_sync_mtx; // one replay at a time
+    std::atomic<unsigned long> m_synced;
+    std::atomic<unsigned long> m_cancelled;
+    bool m_running;
+    std::mutex m_thread_mtx;
+    std::condition_variable m_thread_cv;
+    std::thread m_thread;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace ToolFramework {
+  
+  /* Bounded lock-free multi-producer multi-consumer queue (D. Vyukov's sequence-numbered ring).
+     Push and Pop never block; they return false when the queue is full or empty respectively.
+     Capacity is rounded up to a power of two. */
+  
+  template<typename T> class MPMCQueue{
+    
+  public:
+    
+    MPMCQueue(size_t capacity){
+      size_t size=2;
+      while(size<capacity) size<<=1;
+      m_mask = size-1;
+      m_cells = std::vector<Cell>(size);
+      for(size_t i=0; i<size; ++i) m_cells[i].sequence.store(i, std::memory_order_relaxed);
+      m_enqueue_pos.store(0, std::memory_order_relaxed);
+      m_dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+    
+    bool Push(T&& item){
+      Cell* cell;
+      size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      while(true){
+        cell = &m_cells[pos & m_mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if(diff==0){
+          if(m_enqueue_pos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) break;
+        }
+        else if(diff<0) return false; // full
+        else pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      }
+      cell->data = std::move(item);
+      cell->sequence.store(pos+1, std::memory_order_release);
+      return true;
+    }
+    
+    bool Pop(T& item){
+      Cell* cell;
+      size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+      while(true){
+        cell = &m_cells[pos & m_mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos+1);
+        if(diff==0){
+          if(m_dequeue_pos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) break;
+        }
+        else if(diff<0) return false; // empty
+        else pos = m_dequeue_pos.load(std::memory_order_relaxed);
+      }
+      item = std::move(cell->data);
+      cell->sequence.store(pos+m_mask+1, std::memory_order_release);
+      return true;
+    }
+    
+    size_t Capacity() const { return m_mask+1; }
+    
+  private:
+    
+    struct Cell{
+      std::atomic<size_t> sequence;
+      T data;
+    };
+    
+    // keep the producer and consumer indices on separate cache lines
+    alignas(64) std::vector<Cell> m_cells;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_enqueue_pos;
+    alignas(64) std::atomic<size_t> m_dequeue_pos;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef MONITORING_AGGREGATOR_H
+#define MONITORING_AGGREGATOR_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+
+namespace ToolFramework {
+  
+  /* Reduces high-rate monitoring values client side.
+     Samples are recorded against a (subject, field) handle; once per window every subject with new samples
+     is sent as one monitoring JSON holding <field>_min, <field>_max, <field>_mean, <field>_rms (standard
+     deviation, as in ROOT) and <field>_count.
+     Record(handle, value) is lock-free and may be called from any number of threads. Samples go into one
+     of two accumulator banks; the reducer thread flips the active bank and waits for in-flight writers
+     before reading the retired one. Registering new fields takes a lock, so do it outside the hot path. */
+  
+  class MonitoringAggregator{
+    
+  public:
+    
+    MonitoringAggregator(std::function<bool(const std::string& json_data, const std::string& subject)> send_function, const unsigned int window_ms=1000, const unsigned int max_fields=1024);
+    ~MonitoringAggregator();
+    
+    int Register(const std::string& subject, const std::string& field); // returns a handle for Record, or -1 if max_fields are in use
+    void Record(const int handle, const double value);
+    bool Record(const std::string& subject, const std::string& field, const double value); // convenience, registers on first use
+    
+    bool Flush(); // reduce and send the current window now
+    void SetWindow(const unsigned int window_ms);
+    unsigned int GetWindow();
+    
+  private:
+    
+    struct Accumulator{
+      std::atomic<uint64_t> count{0};
+      std::atomic<double> sum{0};
+      std::atomic<double> sum_squares{0};
+      std::atomic<double> min{0};
+      std::atomic<double> max{0};
+      void Reset();
+    };
+    
+    struct Field{
+      std::string subject;
+      std::string name;
+    };
+    
+    void Thread();
+    
+    std::function<bool(const std::string&, const std::string&)> m_send_function;
+    std::atomic<unsigned int> m_window_ms;
+    const unsigned int m_max_fields;
+    
+    std::vector<Accumulator> m_banks[2];
+    std::atomic<unsigned int> m_active_bank{0};
+    std::atomic<unsigned int> m_writers[2];
+    
+    std::vector<Field> m_fields;
+    std::map<std::pair<std::string, std::string>, int> m_handles;
+    std::atomic<unsigned int> m_num_fields{0};
+    std::shared_mutex m_fields_mtx;
+    
+    std::mutex m_flush_mtx;
+    std::mutex m_thread_mtx;
+    std::condition_variable m_thread_cv;
+    bool m_running;
+    std::thread m_thread;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef MONITORING_SCHEMA_H
+#define MONITORING_SCHEMA_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <functional>
+#include <cstdint>
+
+namespace ToolFramework {
+  
+  enum class SchemaFieldType : char { Float='f', Double='d', Int='i' }; // 4 bytes, 8 bytes, zigzag varint
+  
+  /* Positional encoding for monitoring subjects that send the same fields every time.
+     Register() fixes a subject's field names and types once; Send() then ships only the values, packed in
+     field order and base64'd into {"schema":"<id>","values":"..."} on the subject, instead of repeating every
+     key. The schema itself goes out as {"schema":"<id>","subject":..,"fields":["name:type",..]} on the
+     'monitoring_schema' subject when first used and again every 'announce_s', so late receivers catch up.
+     Ids are a hash of the subject and fields, so they are stable across restarts and shared by devices
+     sending the same layout. On the receiving side, Learn() takes announcements and Expand() turns compact
+     messages back into ordinary monitoring JSON. Values are little-endian on the wire, on any host. */
+  
+  class MonitoringSchema{
+    
+  public:
+    
+    MonitoringSchema(std::function<bool(std::string&& json_data, const std::string& subject)> send_function=nullptr, const unsigned int announce_s=60);
+    
+    uint32_t Register(const std::string& subject, const std::vector<std::pair<std::string, SchemaFieldType> >& fields); // 0 if the layout is empty, or its id collides with a different one already known (send it as ordinary monitoring data)
+    bool Send(const uint32_t schema_id, const std::vector<double>& values); // values in the order registered
+    bool Encode(const uint32_t schema_id, const std::vector<double>& values, std::string& json_data, std::string& subject);
+    
+    bool Learn(const std::string& announcement);
+    bool Expand(const std::string& json_data, std::string& expanded, std::string* subject=nullptr);
+    static bool IsCompact(const std::string& json_data);
+    
+    static const std::string announce_subject;
+    
+  private:
+    
+    struct Schema{
+      std::string subject;
+      std::vector<std::pair<std::string, SchemaFieldType> > fields;
+      std::string announcement;
+      std::chrono::steady_clock::time_point announced;
+      bool ever_announced=false;
+    };
+    
+    static std::string Id(const uint32_t schema_id);
+    
+    std::function<bool(std::string&&, const std::string&)> m_send_function;
+    const std::chrono::seconds m_announce_period;
+    std::map<uint32_t, Schema> m_schemas;
+    std::shared_mutex m_mtx;
+    std::mutex m_announce_mtx;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef MULTICAST_SENDER_H
+#define MULTICAST_SENDER_H
+
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <DAQBackend.h>
+#include <MPMCQueue.h>
+#include <FragmentReassembler.h>
+
+namespace ToolFramework {
+  
+  /* Funnels logs and monitoring data from any number of threads onto the backend's multicast sockets.
+     Callers push onto a lock-free queue and return at once; a single sender thread drains it, so the
+     sockets are only ever used from one thread, messages leave in the order they were queued, and
+     producers never contend on a lock. If the queue is full the caller waits up to 'block_ms' for room,
+     then drops the message (counted in Dropped()) rather than jump the queue. With a queue size of 0 every
+     send is direct (serialised by a mutex), and the return value reports the send itself. Messages are
+     stamped when queued, unless the caller gives a timestamp, so time spent in the queue doesn't shift
+     them. Payloads longer than 'max_payload' bytes go out as several fragments, see FragmentReassembler. */
+  
+  class MulticastSender{
+    
+  public:
+    
+    MulticastSender(DAQBackend* backend, const size_t queue_size=4096, const size_t max_payload=0, const unsigned int block_ms=100); // max_payload 0 never fragments
+    ~MulticastSender();
+    
+    bool SendLog(const std::string& message, LogLevel severity=LogLevel::Message, const std::string& device="", const uint64_t timestamp=0);
+    bool SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device="", const uint64_t timestamp=0);
+    bool SendLog(std::string&& message, LogLevel severity=LogLevel::Message, const std::string& device="", const uint64_t timestamp=0); // payload is moved onto the queue, not copied
+    bool SendMonitoringData(std::string&& json_data, const std::string& subject, const std::string& device="", const uint64_t timestamp=0);
+    
+    unsigned long Sent();
+    unsigned long Failed();
+    unsigned long Dropped(); // messages that found the queue full for block_ms
+    unsigned long Fragmented(); // messages sent in fragments
+    
+  private:
+    
+    struct Message{
+      bool log=true;
+      std::string payload;
+      std::string subject;
+      std::string device;
+      LogLevel severity=LogLevel::Message;
+      uint64_t timestamp=0;
+    };
+    
+    bool Submit(Message&& message);
+    void Wake();
+    bool Send(const Message& message);
+    bool SendPayload(const Message& message, const std::string& payload);
+    void Thread();
+    
+    DAQBackend* m_backend;
+    MPMCQueue<Message>* m_queue;
+    std::mutex m_send_mtx;
+    const size_t m_max_payload;
+    const unsigned int m_block_ms;
+    uint64_t m_next_fragment_id; // only used under m_send_mtx
+    std::vector<std::string> m_fragments;
+    
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_idle;
+    std::mutex m_idle_mtx;
+    std::condition_variable m_idle_cv;
+    std::thread m_thread;
+    
+    std::atomic<unsigned long> m_sent;
+    std::atomic<unsigned long> m_failed;
+    std::atomic<unsigned long> m_dropped;
+    std::atomic<unsigned long> m_fragmented;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef NETWORK_BACKEND_H
+#define NETWORK_BACKEND_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <map>
+#include <shared_mutex>
+#include <DAQBackend.h>
+#include <SlowControlCollection.h>
+#include <SpanTracer.h>
+
+namespace ToolFramework {
+  
+  /* the normal transport: service discovery plus the ToolDAQ services stack over ZMQ.
+     Discovery parameters come from the configuration (service_discovery_*). In adaptive mode the beacon period
+     starts at service_discovery_beacon_s and doubles, up to service_discovery_beacon_max_s, each time four
+     periods pass with requests made and none failing; an idle device holds its period, since silence proves
+     nothing, and a failed request drops it straight back, since the middleman may have lost track of us.
+     ServiceDiscovery fixes its period when constructed and has no way to change it, so a new period means a
+     new instance, started at once. The first beacon, and each restart for new discovery settings, is delayed
+     by a random jitter so that devices started or reconfigured together don't beacon in lockstep.
+     Reload() applies a changed configuration in place: new discovery settings restart discovery, and new
+     services settings (ports, addresses, timeouts, resend period) recreate the services on the same ZMQ
+     context once calls in progress have finished. Anything unchanged is left running.
+     Each request's deadline is its timeout from the call. The services request format has no field to carry
+     it to the middleman, so it is only enforced here: a request that succeeds after its deadline keeps its
+     result and is counted in LateReplies(). */
+  
+  class NetworkBackend : public DAQBackend{
+    
+  public:
+    
+    NetworkBackend(Store& vars, SlowControlCollection* sc_vars, SpanTracer* spans=nullptr); // spans for connecting and discovery restarts
+    ~NetworkBackend();
+    
+    bool SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout);
+    bool SQLQuery(const std::string& query, std::string& response, const unsigned int timeout);
+    bool SQLQuery(const std::string& query, const unsigned int timeout);
+    bool Probe(const std::string& query, std::string& response, const unsigned int timeout);
+    bool SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp);
+    bool SendAlarm(const std::string& message, bool critical, const std::string& device, const uint64_t timestamp, const unsigned int timeout);
+    bool SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp);
+    bool SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout);
+    bool GetCalibrationData(std::string& json_data, int& version, const std::string& device, const unsigned int timeout);
+    bool SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout);
+    bool GetDeviceConfig(std::string& json_data, const int version, const std::string& device, const unsigned int timeout);
+    bool GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout);
+    bool GetRunModeConfig(std::string& json_data, const std::string& name, const int version, const unsigned int timeout);
+    bool GetRunDeviceConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, int* version, const unsigned int timeout);
+    bool SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int& version, const unsigned int timeout);
+    bool SendPlotlyPlot(const std::string& name, const std::string& json_trace, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool SendPlotlyPlot(const std::string& name, const std::vector<std::string>& json_traces, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int& version, const unsigned int timeout);
+    
+    bool Reload(Store& vars);
+    unsigned int GetBeaconPeriod(); // current period in s, 0 before the first beacon
+    static const std::vector<std::string>& ReloadKeys(); // the services and service_discovery_* settings Reload() applies
+    unsigned long TimedOut(); // requests that failed at their deadline
+    unsigned long LateReplies(); // requests that succeeded, but after their deadline
+    
+  private:
+    
+    bool Track(const bool ok, const std::chrono::steady_clock::time_point deadline); // outcome feeds the adaptive beacon period
+    void DiscoveryThread();
+    
+    Services* m_services;
+    std::shared_mutex m_services_mtx; // calls share it, Reload takes it to replace m_services
+    std::map<std::string, std::string> m_services_settings;
+    SpanTracer* m_spans;
+    SlowControlCollection* m_sc_vars;
+    zmq::context_t* m_context=nullptr;
+    ServiceDiscovery* mp_SD=nullptr;
+    
+    std::string m_name;
+    boost::uuids::uuid m_UUID;
+    std::string m_sd_address="239.192.1.1";
+    int m_sd_port=5000;
+    int m_sd_remote_port=60000;
+    std::atomic<unsigned int> m_sd_beacon_s=5; // read by Track without m_sd_mtx; written under it
+    unsigned int m_sd_beacon_max_s=30;
+    unsigned int m_sd_kick_s=60;
+    unsigned int m_sd_jitter_ms=0;
+    std::atomic<bool> m_sd_adaptive=false;
+    std::atomic<unsigned int> m_beacon_period;
+    std::atomic<bool> m_request_failed;
+    std::atomic<bool> m_request_succeeded;
+    std::atomic<unsigned long> m_timed_out=0;
+    std::atomic<unsigned long> m_late_replies=0;
+    bool m_sd_restart; // set under m_sd_mtx by Reload
+    bool m_running;
+    std::mutex m_sd_mtx;
+    std::condition_variable m_sd_cv;
+    std::thread m_sd_thread;
+    
+  };
+  
+}
+
+#endif
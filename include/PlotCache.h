@@ -0,0 +1,85 @@
+#ifndef PLOT_CACHE_H
+#define PLOT_CACHE_H
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <typeindex>
+
+namespace ToolFramework {
+  
+  /* LRU cache of fetched plots, keyed by plot and version. A given version of a plot never changes, so an entry
+     is valid for as long as it's held; the caller only has to find out which version is current. Each entry holds
+     the two strings the plot was fetched as (draw options + json, or trace + layout) and optionally one object
+     parsed from them (e.g. the TObject from TBufferJSON::FromJSON), so repeated displays of an unchanged plot
+     need neither the download nor the parse. Entries are evicted least recently used first once the strings
+     plus the caller's size estimate for parsed objects exceed 'max_bytes'. */
+  
+  class PlotCache{
+    
+  public:
+    
+    PlotCache(const size_t max_bytes=64*1024*1024);
+    
+    bool Get(const std::string& key, const int version, std::string& first, std::string& second);
+    void Put(const std::string& key, const int version, const std::string& first, const std::string& second);
+    
+    template<typename T> std::shared_ptr<const T> GetParsed(const std::string& key, const int version){
+      std::lock_guard<std::mutex> lock(m_mtx);
+      Entry* entry = Find(key, version);
+      if(!entry || !entry->parsed || entry->parsed_type!=std::type_index(typeid(T))){
+        ++m_misses;
+        return nullptr;
+      }
+      ++m_hits;
+      return std::static_pointer_cast<const T>(entry->parsed);
+    }
+    template<typename T> void SetParsed(const std::string& key, const int version, std::shared_ptr<const T> parsed, const size_t bytes){
+      std::lock_guard<std::mutex> lock(m_mtx);
+      Entry* entry = Find(key, version);
+      if(!entry) return; // evicted meanwhile
+      m_bytes -= entry->parsed_bytes;
+      entry->parsed = parsed;
+      entry->parsed_type = std::type_index(typeid(T));
+      entry->parsed_bytes = bytes;
+      m_bytes += bytes;
+      Evict();
+    }
+    
+    void Clear();
+    
+    unsigned long Hits();
+    unsigned long Misses();
+    size_t Bytes();
+    
+  private:
+    
+    struct Entry{
+      std::string id;
+      std::string first;
+      std::string second;
+      std::shared_ptr<const void> parsed;
+      std::type_index parsed_type=std::type_index(typeid(void));
+      size_t parsed_bytes=0;
+    };
+    
+    Entry* Find(const std::string& key, const int version); // moves a hit to the front; m_mtx must be held
+    void Evict(); // m_mtx must be held
+    
+    const size_t m_max_bytes;
+    size_t m_bytes;
+    std::list<Entry> m_lru; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+    std::mutex m_mtx;
+    
+    std::atomic<unsigned long> m_hits;
+    std::atomic<unsigned long> m_misses;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef RELIABLE_LOGGER_H
+#define RELIABLE_LOGGER_H
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <SQLInsertBuilder.h>
+#include <Services.h>
+
+namespace ToolFramework {
+  
+  /* Lossless log transport: logs are queued and written to the database in batches by a background thread,
+     each batch being acknowledged by the server before it's dropped from the queue; failed batches are
+     retried with backoff. When the queue is full the caller either blocks until there's space (up to
+     'block_timeout_ms') or, if a spool file is configured, the log is appended to it and replayed once the
+     queue has drained. Either way nothing is lost silently: SendLog only returns false if the log could not be
+     queued or spooled. On destruction the queue gets one last bounded flush; what's left is spooled, or without a
+     spool file counted in Dropped() and reported on stderr. */
+  
+  class ReliableLogger{
+    
+  public:
+    
+    // insert writes one batch of (time, device, severity, message) rows, returning false with an error on failure
+    ReliableLogger(std::function<bool(const std::vector<SQLRow>& rows, std::string& error)> insert, const std::string& default_device, const size_t queue_size=10000, const size_t batch_size=500, const std::string& spool_file="", const unsigned int block_timeout_ms=1000);
+    ~ReliableLogger();
+    
+    bool SendLog(const std::string& message, LogLevel severity, const std::string& device="", const uint64_t timestamp=0); // timestamp in ms since epoch, 0 for now
+    bool SendLog(std::string&& message, LogLevel severity, const std::string& device="", const uint64_t timestamp=0);
+    bool Flush(const unsigned int timeout_ms); // wait for the queue (and spool) to drain
+    
+    size_t Queued();
+    unsigned long Written();
+    unsigned long Spooled();
+    unsigned long Retries();
+    unsigned long Dropped(); // lost at shutdown with no spool to keep them
+    
+  private:
+    
+    void Thread();
+    bool Spool(const SQLRow& row);
+    bool ReplaySpool();
+    
+    std::function<bool(const std::vector<SQLRow>&, std::string&)> m_insert;
+    std::string m_default_device;
+    const size_t m_queue_size;
+    const size_t m_batch_size;
+    const std::string m_spool_file;
+    const unsigned int m_block_timeout_ms;
+    
+    std::deque<SQLRow> m_queue;
+    size_t m_in_flight;
+    bool m_spool_pending;
+    std::mutex m_mtx;
+    std::condition_variable m_work_cv;  // wakes the writer
+    std::condition_variable m_space_cv; // wakes blocked callers and Flush
+    bool m_running;
+    std::thread m_thread;
+    
+    std::atomic<unsigned long> m_written;
+    std::atomic<unsigned long> m_spooled;
+    std::atomic<unsigned long> m_retries;
+    std::atomic<unsigned long> m_dropped;
+    
+  };
+  
+}
+
+#endif
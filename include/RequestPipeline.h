@@ -0,0 +1,62 @@
+#ifndef REQUEST_PIPELINE_H
+#define REQUEST_PIPELINE_H
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <chrono>
+#include <SpanTracer.h>
+
+namespace ToolFramework {
+  
+  /* Keeps up to 'window' request/reply calls outstanding at once.
+     The services backend matches replies to requests by message id, so concurrent callers share the one
+     middleman connection and replies complete in whatever order they arrive. Submit queues a call and
+     returns a future immediately; each worker thread carries one outstanding request, so the number of
+     workers is the in-flight window.
+     Every call has a timeout in ms, covering time spent queued; a request whose timeout has passed
+     before a worker picks it up fails without being sent, otherwise the call receives what remains. */
+  
+  class RequestPipeline{
+    
+  public:
+    
+    RequestPipeline(const unsigned int window=8, SpanTracer* spans=nullptr); // spans show time queued and the call itself
+    ~RequestPipeline();
+    
+    std::future<bool> Submit(std::function<bool(const unsigned int timeout)> call, const unsigned int timeout);
+    
+    unsigned int GetWindow();
+    size_t Queued();
+    unsigned int InFlight();
+    unsigned long Expired(); // requests that timed out before being sent
+    
+  private:
+    
+    struct Request{
+      std::function<bool(const unsigned int)> call;
+      std::promise<bool> promise;
+      std::chrono::steady_clock::time_point deadline;
+      std::chrono::steady_clock::time_point submitted;
+    };
+    
+    void Worker();
+    
+    std::deque<Request> m_queue;
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    SpanTracer* m_spans;
+    bool m_running;
+    unsigned int m_in_flight;
+    unsigned long m_expired;
+    std::vector<std::thread> m_workers;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef SQL_INSERT_BUILDER_H
+#define SQL_INSERT_BUILDER_H
+
+#include <string>
+#include <vector>
+#include <variant>
+#include <cstdint>
+
+namespace ToolFramework {
+  
+  typedef std::variant<std::monostate, bool, int64_t, double, std::string> SQLValue; // monostate is NULL
+  typedef std::vector<SQLValue> SQLRow;
+  
+  /* Builds set-based INSERT statements for bulk loading.
+     Each batch becomes a single statement that hands postgres the whole batch as one JSON document:
+       INSERT INTO table ( cols ) SELECT cols FROM json_populate_recordset(NULL::table, '[...]')
+     so the server parses one statement per batch and converts values using the table's own column
+     types, much like COPY. Each batch is applied atomically.
+     Table and column names must be plain identifiers ([A-Za-z0-9_], optionally schema qualified); they
+     are used unquoted, so follow postgres' usual lower-case folding. */
+  
+  class SQLInsertBuilder{
+    
+  public:
+    
+    static bool BuildStatements(const std::string& table, const std::vector<std::string>& columns, const std::vector<SQLRow>& rows, std::vector<std::string>& statements, std::string& error, const unsigned int batch_size=1000);
+    static bool ValidIdentifier(const std::string& name, const bool allow_schema=false);
+    
+  private:
+    
+    static void AppendValue(std::string& out, const SQLValue& value);
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef SQL_RESULT_SET_H
+#define SQL_RESULT_SET_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+namespace ToolFramework {
+  
+  enum class SQLColumnType{ Null, Bool, Int, Float, Timestamp, String };
+  
+  /* Typed, column-wise view of a query result.
+     The query is wrapped server side so that column names are sent once, followed by the rows as bare
+     value arrays, rather than one keyed JSON object per row. The reply is decoded once into one typed
+     buffer per column:
+       Bool, Int, Timestamp -> Ints()  (timestamps are microseconds since the unix epoch, UTC)
+       Float                -> Floats()
+       String               -> Strings() (nested JSON objects/arrays are kept as raw JSON text)
+     The JSON the rows arrive as doesn't carry the SQL column types, so the caller can Declare() them; a
+     declared column whose values don't fit its type fails the decode. Undeclared columns get a type that
+     doesn't depend on the values that happen to be in this result: true/false is Bool, any number Float,
+     text String (so an id or a timestamp has to be declared Int or Timestamp to be read as one), and any
+     mix String. Rows keep the order of the query. Null cells read as 0 / "" and are flagged by IsNull; an
+     undeclared column with only nulls is typed Null and reads that way through all three accessors. */
+  
+  class SQLResultSet{
+    
+  public:
+    
+    SQLResultSet();
+    
+    static std::string WrapQuery(const std::string& query);
+    bool Decode(const std::string& response);
+    void Clear(); // the result; declarations are kept
+    
+    void Declare(const std::string& column, const SQLColumnType type);
+    void ClearDeclarations();
+    
+    size_t Rows() const;
+    size_t Columns() const;
+    std::vector<std::string> ColumnNames() const;
+    int ColumnIndex(const std::string& name) const; // -1 if not found
+    const std::string& ColumnName(const size_t column) const;
+    SQLColumnType ColumnType(const size_t column) const;
+    bool IsNull(const size_t row, const size_t column) const;
+    
+    const std::vector<int64_t>& Ints(const size_t column) const;
+    const std::vector<double>& Floats(const size_t column) const;
+    const std::vector<std::string>& Strings(const size_t column) const;
+    
+    const std::string& Error() const;
+    void SetError(const std::string& error);
+    
+  private:
+    
+    struct Column{
+      std::string name;
+      SQLColumnType type;
+      std::vector<int64_t> ints;
+      std::vector<double> floats;
+      std::vector<std::string> strings;
+      std::vector<bool> nulls;
+    };
+    
+    bool DecodeTable(std::string_view columns, std::string_view rows);
+    
+    std::vector<Column> m_columns;
+    std::map<std::string, SQLColumnType> m_declared;
+    size_t m_rows;
+    std::string m_error;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef SHARED_MEMORY_RING_H
+#define SHARED_MEMORY_RING_H
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <chrono>
+
+namespace ToolFramework {
+  
+  /* Fixed-slot ring buffer in POSIX shared memory, connecting client processes to a node-local agent.
+     Producers (clients) claim slots with a sequence-numbered lock-free scheme, so any number of processes
+     and threads can submit concurrently. The agent consumes slots in order.
+     One-way messages are released by the agent as soon as they've been read. For requests the client keeps
+     the slot: the agent writes the reply into the same slot and flags it, and the client releases the slot
+     once it has read the reply. A client that times out marks the slot abandoned, and the agent
+     releases it after writing the reply.
+     Each claim records the client's pid and how long it means to hold the slot. Reclaim(), on the agent,
+     frees a slot that has sat for a grace period with its client dead or past that deadline: one claimed
+     but never published, which would stall the ring, or one whose reply is never collected. Pids are
+     checked in the agent's pid namespace, so clients in containers must share it.
+     A payload or reply larger than a slot goes in a spill segment of its own, named after the ring, its
+     generation and the slot position, which the reader unlinks once it has copied it out.
+     Every Create() stamps a new generation, and a clean shutdown marks the segment closed. Clients check
+     for both and remap to the new segment, so they follow an agent restart without being reopened;
+     mappings replaced this way are kept until Close(), as other threads may still be using them. */
+  
+  enum class AgentMessageType : uint32_t { Log=1, Monitoring, Request };
+  
+  class SharedMemoryRing{
+    
+  public:
+    
+    struct Slot; // opaque outside the ring
+    
+    SharedMemoryRing();
+    ~SharedMemoryRing();
+    
+    bool Create(const std::string& name, const uint32_t slots=1024, const uint32_t slot_size=16384); // agent side, replaces any existing segment
+    bool Open(const std::string& name); // client side
+    void Close();
+    
+    uint32_t SlotSize(); // larger payloads and replies are spilled
+    uint64_t Generation();
+    
+    // client side
+    bool Send(AgentMessageType type, const std::string& payload, const unsigned int timeout_ms=0); // one-way, timeout is how long to wait for space
+    bool Request(const std::string& payload, std::string& reply, const unsigned int timeout_ms);
+    
+    // agent side. Receive returns a handle for Reply if the message was a request, or nullptr
+    bool Receive(AgentMessageType& type, std::string& payload, Slot*& request, const unsigned int timeout_ms);
+    bool Abandoned(Slot* request); // the client has stopped waiting, so the request needn't be served
+    bool Reply(Slot* request, const bool ok, const std::string& reply); // false if the client had stopped waiting and the reply was dropped
+    unsigned int Reclaim(); // frees slots held by dead or overdue clients; call periodically, from the thread that calls Receive
+    unsigned long Reclaimed();
+    
+  private:
+    
+    struct Header;
+    struct Mapping;
+    
+    static Mapping* Map(const std::string& name);
+    static void Unmap(Mapping* map);
+    Mapping* Current(); // the mapping to use, after following a clean agent restart
+    bool Refresh(Mapping* stale); // true if the agent has been restarted and calls should use its new segment
+    
+    std::string SpillName(Mapping* map, const uint64_t position, const char* kind);
+    Slot* GetSlot(Mapping* map, uint64_t position);
+    Slot* Claim(Mapping* map, uint64_t& position, const unsigned int timeout_ms, const unsigned int hold_ms);
+    bool Write(Mapping* map, Slot* slot, const uint64_t position, const std::string& data, const char* kind);
+    bool Publish(Mapping* map, Slot* slot, const uint64_t position); // false if the agent has reclaimed it
+    void Release(Mapping* map, Slot* slot);
+    
+    std::string m_name;
+    bool m_owner;
+    std::atomic<Mapping*> m_mapping;
+    std::mutex m_remap_mtx;
+    std::vector<Mapping*> m_retired;
+    
+    std::mutex m_replied_mtx;
+    struct Uncollected{
+      Slot* slot;
+      uint64_t position;
+      std::chrono::steady_clock::time_point since;
+    };
+    std::vector<Uncollected> m_replied; // replies their clients have yet to read
+    uint64_t m_stalled_position;
+    std::chrono::steady_clock::time_point m_stalled_since;
+    std::atomic<unsigned long> m_reclaimed;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef SLOW_CONTROL_CHANGE_LOG_H
+#define SLOW_CONTROL_CHANGE_LOG_H
+
+#include <string>
+#include <map>
+#include <set>
+#include <deque>
+#include <mutex>
+#include <cstdint>
+
+namespace ToolFramework {
+  
+  /* Versioned change log over a slow control collection, so consumers can refresh with only what changed.
+     Each Update diffs a full SlowControlCollection::Print() (a JSON object keyed by control name) against the
+     previous one; every added or modified control is stamped with a new version, and removals are remembered
+     as tombstones. Changes(N) returns
+       {"version":V,"full":false,"changes":{<controls changed after N>},"removed":[<controls removed after N>]}
+     or, for N=0 or when N predates the oldest tombstone kept, a full snapshot with "full":true that the consumer
+     should replace its state with. Versions start from the process start time (ms<<10) rather than 0, so a
+     version from a previous process, e.g. before a restart, is below the floor and also gets a full snapshot. */
+  
+  class SlowControlChangeLog{
+    
+  public:
+    
+    SlowControlChangeLog(const size_t max_removed=1024);
+    
+    bool Update(const std::string& snapshot_json);
+    std::string Changes(const uint64_t since_version);
+    uint64_t Version();
+    void Ignore(const std::string& name); // e.g. the control that serves the change log itself
+    
+  private:
+    
+    struct Entry{
+      std::string json;
+      uint64_t version;
+    };
+    
+    std::map<std::string, Entry> m_entries;
+    std::deque<std::pair<uint64_t, std::string> > m_removed; // oldest first
+    std::set<std::string> m_ignored;
+    const size_t m_max_removed;
+    uint64_t m_version;
+    uint64_t m_floor; // changes since a version below this (the start epoch at first) can't be given as a delta
+    std::mutex m_mtx;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef SLOW_CONTROL_HISTORY_H
+#define SLOW_CONTROL_HISTORY_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+namespace ToolFramework {
+  
+  struct SampleSummary{
+    size_t count=0;
+    double min=0;
+    double max=0;
+    double mean=0;
+    double rms=0;
+    int64_t first_ms=0; // time of the earliest and latest samples in the range
+    int64_t last_ms=0;
+  };
+  
+  /* Fixed size ring of (time in ms since epoch, value) samples, allocated up front. Push and the queries never
+     take a lock: each slot carries the index of the sample in it, written last by Push and checked by readers
+     before and after copying the sample out, so a reader skips a slot that is being overwritten. */
+  
+  class SampleRing{
+    
+  public:
+    
+    SampleRing(const size_t capacity);
+    
+    void Push(const int64_t time_ms, const double value);
+    size_t Range(const int64_t from_ms, const int64_t to_ms, std::vector<std::pair<int64_t, double> >& samples) const; // oldest first
+    SampleSummary Summarise(const int64_t from_ms, const int64_t to_ms) const;
+    size_t Capacity() const;
+    
+  private:
+    
+    struct Slot{
+      std::atomic<uint64_t> index{UINT64_MAX};
+      std::atomic<int64_t> time_ms{0};
+      std::atomic<double> value{0};
+    };
+    
+    template<typename F> void Visit(const int64_t from_ms, const int64_t to_ms, F&& visit) const;
+    
+    std::unique_ptr<Slot[]> m_slots;
+    const size_t m_capacity;
+    std::atomic<uint64_t> m_head; // index the next sample will take
+    
+  };
+  
+  /* Recent history of selected slow control variables, for trend displays and interlocks without a database
+     query. Enable() gives a variable its own SampleRing; the sampler thread then reads every enabled variable
+     each 'period_ms' through 'read' (values can also be recorded directly with Record). */
+  
+  class SlowControlHistory{
+    
+  public:
+    
+    SlowControlHistory(std::function<bool(const std::string& name, double& value)> read, const unsigned int period_ms=1000);
+    ~SlowControlHistory();
+    
+    bool Enable(const std::string& name, const size_t samples=600);
+    void Disable(const std::string& name);
+    bool Record(const std::string& name, const double value, const int64_t time_ms=0); // 0 for now
+    
+    bool Range(const std::string& name, const int64_t from_ms, const int64_t to_ms, std::vector<std::pair<int64_t, double> >& samples);
+    bool Summarise(const std::string& name, const int64_t from_ms, const int64_t to_ms, SampleSummary& summary);
+    bool Last(const std::string& name, const int64_t seconds, SampleSummary& summary); // over the last 'seconds'
+    
+  private:
+    
+    std::shared_ptr<SampleRing> Find(const std::string& name);
+    void Thread();
+    
+    std::function<bool(const std::string&, double&)> m_read;
+    const unsigned int m_period_ms;
+    std::map<std::string, std::shared_ptr<SampleRing> > m_rings;
+    std::shared_mutex m_rings_mtx; // only for enabling and disabling variables
+    
+    bool m_running;
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+    
+  };
+  
+}
+
+#endif
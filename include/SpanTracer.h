@@ -0,0 +1,101 @@
+#ifndef SPAN_TRACER_H
+#define SPAN_TRACER_H
+
+#include <string>
+#include <cstdio>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <MPMCQueue.h>
+
+namespace ToolFramework {
+  
+  /* Writes begin/end spans of DAQInterface calls and their phases (queueing, cache probes, the services call
+     itself, discovery restarts) to a Chrome trace JSON file, which chrome://tracing and ui.perfetto.dev open
+     directly. Spans on one thread nest by time, so a slow GetRunConfig shows which inner step took the time.
+     Recording a span is a clock read and a push onto a lock-free queue; a writer thread formats and writes.
+     Only one in 'sample_every' outermost calls is traced, and spans nested inside it follow its decision.
+     Names and categories must be string literals (or otherwise outlive the tracer): only the pointer is
+     queued. If the queue is full the span is dropped and counted. */
+  
+  class SpanTracer{
+    
+  public:
+    
+    SpanTracer(const unsigned int sample_every=1, const size_t queue_size=65536);
+    ~SpanTracer();
+    
+    bool Open(const std::string& trace_file);
+    void Close();
+    
+    void Record(const char* name, const char* category, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const int ok=-1, const int64_t waited_us=-1); // -1 for not applicable
+    bool Sampled(); // whether the call this thread is in is being traced
+    
+    unsigned long Written();
+    unsigned long Dropped();
+    
+    // RAII span: SpanTracer::Scope span(tracer, "GetDeviceConfig"); a null tracer makes it a no-op
+    class Scope{
+      
+    public:
+      
+      Scope(SpanTracer* tracer, const char* name, const char* category="call");
+      ~Scope();
+      Scope(const Scope&)=delete;
+      Scope& operator=(const Scope&)=delete;
+      
+      bool Ok(const bool ok); // records the outcome and passes it back, for 'return span.Ok(...)'
+      void Waited(const std::chrono::steady_clock::duration waited); // time spent queued before the span began
+      
+    private:
+      
+      SpanTracer* m_tracer;
+      const char* m_name;
+      const char* m_category;
+      bool m_sampled;
+      std::chrono::steady_clock::time_point m_start;
+      int m_ok;
+      int64_t m_waited_us;
+      
+    };
+    
+  private:
+    
+    struct Span{
+      const char* name=nullptr;
+      const char* category=nullptr;
+      int64_t start_us=0;
+      int64_t duration_us=0;
+      unsigned int tid=0;
+      int ok=-1;
+      int64_t waited_us=-1;
+    };
+    
+    bool Enter(); // called at the start of every Scope, returns whether it is sampled
+    void Leave();
+    void Push(const char* name, const char* category, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const int ok, const int64_t waited_us);
+    void Thread();
+    void Write(const Span& span);
+    
+    const unsigned int m_sample_every;
+    std::atomic<unsigned long> m_calls;
+    MPMCQueue<Span> m_queue;
+    std::chrono::steady_clock::time_point m_start;
+    
+    FILE* m_file;
+    bool m_first;
+    std::atomic<bool> m_running;
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+    
+    std::atomic<unsigned long> m_written;
+    std::atomic<unsigned long> m_dropped;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef STAND_IN_BACKEND_H
+#define STAND_IN_BACKEND_H
+
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <DAQBackend.h>
+
+namespace ToolFramework {
+  
+  /* Local stand-in for the middleman and database, for load tests without a network (see Example/Replay,
+     or 'stand_in_backend 1' in the configuration file). Requests are served by 'workers' concurrent service
+     slots; each holds a slot for base_latency_us plus its request and reply bytes over 'bytes_per_us'. A request that
+     can't get a slot within its timeout fails, as against an overloaded server, and one whose timeout passes
+     while it's being served is cancelled at that point, freeing its slot. Reads return
+     'reply_bytes' of filler JSON. Logs and monitoring data are one-way and accepted at once. */
+  
+  class StandInBackend : public DAQBackend{
+    
+  public:
+    
+    StandInBackend(const unsigned int workers=8, const unsigned int base_latency_us=500, const double bytes_per_us=100, const size_t reply_bytes=1024);
+    
+    bool Serve(const size_t request_bytes, const size_t reply_bytes, const unsigned int timeout); // one request; timeout 0 for one-way messages
+    
+    unsigned long Served();
+    unsigned long Rejected(); // timed out waiting for a slot
+    unsigned long Cancelled(); // timed out while being served
+    
+    bool SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout);
+    bool SQLQuery(const std::string& query, std::string& response, const unsigned int timeout);
+    bool SQLQuery(const std::string& query, const unsigned int timeout);
+    bool SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp);
+    bool SendAlarm(const std::string& message, bool critical, const std::string& device, const uint64_t timestamp, const unsigned int timeout);
+    bool SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp);
+    bool SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout);
+    bool GetCalibrationData(std::string& json_data, int& version, const std::string& device, const unsigned int timeout);
+    bool SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout);
+    bool GetDeviceConfig(std::string& json_data, const int version, const std::string& device, const unsigned int timeout);
+    bool GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout);
+    bool GetRunModeConfig(std::string& json_data, const std::string& name, const int version, const unsigned int timeout);
+    bool GetRunDeviceConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, int* version, const unsigned int timeout);
+    bool SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int& version, const unsigned int timeout);
+    bool SendPlotlyPlot(const std::string& name, const std::string& json_trace, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool SendPlotlyPlot(const std::string& name, const std::vector<std::string>& json_traces, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int& version, const unsigned int timeout);
+    
+  private:
+    
+    bool Read(std::string& json_data, int* version, const unsigned int timeout);
+    bool Write(const size_t request_bytes, int* version, const unsigned int timeout);
+    
+    const unsigned int m_workers;
+    const unsigned int m_base_latency_us;
+    const double m_bytes_per_us;
+    const std::string m_reply;
+    
+    unsigned int m_busy;
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    
+    std::atomic<int> m_version;
+    std::atomic<unsigned long> m_served;
+    std::atomic<unsigned long> m_rejected;
+    std::atomic<unsigned long> m_cancelled;
+    
+  };
+  
+}
+
+#endif
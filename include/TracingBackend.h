@@ -0,0 +1,57 @@
+#ifndef TRACING_BACKEND_H
+#define TRACING_BACKEND_H
+
+#include <DAQBackend.h>
+#include <CallTrace.h>
+#include <SpanTracer.h>
+
+namespace ToolFramework {
+  
+  // wraps another backend, recording the type, payload sizes, timeout, latency and outcome of every call
+  // to a CallTrace file ('trace_file' in the configuration); replay it with Example/Replay. Given a
+  // SpanTracer, each call is also a 'services' span nested in the DAQInterface call that made it.
+  
+  class TracingBackend : public DAQBackend{
+    
+  public:
+    
+    TracingBackend(DAQBackend* backend); // takes ownership
+    ~TracingBackend();
+    
+    bool Open(const std::string& trace_file);
+    bool Reload(Store& vars);
+    void SetSpanTracer(SpanTracer* spans);
+    
+    bool SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout);
+    bool SQLQuery(const std::string& query, std::string& response, const unsigned int timeout);
+    bool SQLQuery(const std::string& query, const unsigned int timeout);
+    bool Probe(const std::string& query, std::string& response, const unsigned int timeout);
+    bool SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp);
+    bool SendAlarm(const std::string& message, bool critical, const std::string& device, const uint64_t timestamp, const unsigned int timeout);
+    bool SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp);
+    bool SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout);
+    bool GetCalibrationData(std::string& json_data, int& version, const std::string& device, const unsigned int timeout);
+    bool SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout);
+    bool GetDeviceConfig(std::string& json_data, const int version, const std::string& device, const unsigned int timeout);
+    bool GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout);
+    bool GetRunModeConfig(std::string& json_data, const std::string& name, const int version, const unsigned int timeout);
+    bool GetRunDeviceConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, int* version, const unsigned int timeout);
+    bool SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int& version, const unsigned int timeout);
+    bool SendPlotlyPlot(const std::string& name, const std::string& json_trace, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool SendPlotlyPlot(const std::string& name, const std::vector<std::string>& json_traces, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout);
+    bool GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int& version, const unsigned int timeout);
+    
+  private:
+    
+    void Record(const TraceCall call, const std::chrono::steady_clock::time_point start, const size_t request_bytes, const size_t reply_bytes, const unsigned int timeout_ms, const bool ok);
+    
+    DAQBackend* m_backend;
+    CallTrace m_trace;
+    SpanTracer* m_spans=nullptr;
+    
+  };
+  
+}
+
+#endif
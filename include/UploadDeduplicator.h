@@ -0,0 +1,58 @@
+#ifndef UPLOAD_DEDUPLICATOR_H
+#define UPLOAD_DEDUPLICATOR_H
+
+#include <string>
+#include <string_view>
+#include <initializer_list>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+namespace ToolFramework {
+  
+  /* Remembers a hash of the last payload uploaded under each key (e.g. "plot:<name>", "calibration:<device>"),
+     so that a byte-identical re-upload can be answered locally with the version created last time instead of
+     sending the body again and creating a new database version. An identical payload is still re-sent once
+     'refresh_s' seconds have passed since it was last sent (0 never re-sends), so the stored timestamp doesn't
+     go stale indefinitely. DAQInterface hashes an explicit timestamp and a plot's lifetime along with the
+     payload, so an upload that changes either is always sent. */
+  
+  class UploadDeduplicator{
+    
+  public:
+    
+    UploadDeduplicator(const unsigned int refresh_s=3600);
+    
+    static uint64_t Hash(std::initializer_list<std::string_view> parts); // 64-bit FNV-1a over all parts
+    
+    bool IsDuplicate(const std::string& key, const uint64_t hash, const size_t bytes, int* version); // true (and *version set, if given) if it can be skipped
+    void Sent(const std::string& key, const uint64_t hash, const int version); // record a successful upload, version -1 if unknown
+    void Forget(const std::string& key);
+    void Clear();
+    
+    unsigned long Hits();
+    unsigned long Misses();
+    unsigned long long BytesSaved();
+    
+  private:
+    
+    struct Entry{
+      uint64_t hash;
+      int version;
+      std::chrono::steady_clock::time_point sent;
+    };
+    
+    const std::chrono::seconds m_refresh;
+    std::map<std::string, Entry> m_entries;
+    std::mutex m_mtx;
+    
+    std::atomic<unsigned long> m_hits;
+    std::atomic<unsigned long> m_misses;
+    std::atomic<unsigned long long> m_bytes_saved;
+    
+  };
+  
+}
+
+#endif
@@ -0,0 +1,266 @@
+#include <AgentBackend.h>
+#include <cstdlib>
+#include <chrono>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  // extra time allowed for the agent to relay the reply after its own timeout
+  const unsigned int agent_margin_ms=100;
+  
+  int GetInt(std::map<std::string, std::string>& reply, const std::string& key, int fallback=-1){
+    
+    std::map<std::string, std::string>::iterator it = reply.find(key);
+    return (it==reply.end()) ? fallback : std::atoi(it->second.c_str());
+    
+  }
+  
+}
+
+AgentBackend::AgentBackend(const std::string& device_name) : m_device_name(device_name), m_timed_out(0){}
+
+bool AgentBackend::Connect(const std::string& ring_name){
+  
+  if(!m_ring.Open(ring_name)) return false;
+  m_has_priority_ring = m_priority_ring.Open(ring_name+"_priority"); // optional, critical alarms use the main ring without it
+  
+  return true;
+  
+}
+
+unsigned long AgentBackend::TimedOut(){
+  
+  return m_timed_out;
+  
+}
+
+const std::string& AgentBackend::Device(const std::string& device){
+  
+  // the agent speaks for many processes, so always name the device explicitly
+  return device.empty() ? m_device_name : device;
+  
+}
+
+bool AgentBackend::Call(JsonUtils::Writer& request, std::map<std::string, std::string>& reply, std::string& error, const unsigned int timeout, const bool priority){
+  
+  reply.clear();
+  
+  // the absolute deadline lets the agent skip a request that's waited too long and bound its own call by what's left
+  uint64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  request.AddNumber("deadline", now_ms+timeout);
+  
+  // the request is built once and handed over whole: the only other copy of a payload is into shared memory
+  std::string response;
+  SharedMemoryRing& ring = (priority && m_has_priority_ring) ? m_priority_ring : m_ring;
+  if(!ring.Request(request.Take(), response, timeout+agent_margin_ms)){
+    if(response=="timed out waiting for agent") ++m_timed_out;
+    error = response;
+    return false;
+  }
+  
+  std::vector<std::pair<std::string, std::string_view> > members;
+  if(!JsonUtils::SplitObject(response, members)){
+    error = "malformed reply from agent: "+response;
+    return false;
+  }
+  for(const std::pair<std::string, std::string_view>& member : members){
+    reply[member.first] = JsonUtils::IsString(member.second) ? JsonUtils::Unquote(member.second) : std::string{member.second};
+  }
+  
+  return true;
+  
+}
+
+bool AgentBackend::SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout){
+  
+  responses.clear();
+  std::map<std::string, std::string> reply;
+  std::string error;
+  if(!Call(JsonUtils::Writer().AddString("call", "SQLQuery").AddString("query", query).AddBool("multi", true).AddNumber("timeout", timeout), reply, error, timeout)){
+    responses.push_back(error);
+    return false;
+  }
+  
+  std::vector<std::string_view> rows;
+  JsonUtils::SplitArray(reply["responses"], rows);
+  for(std::string_view row : rows) responses.push_back(JsonUtils::Unquote(row));
+  
+  return true;
+  
+}
+
+bool AgentBackend::SQLQuery(const std::string& query, std::string& response, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  if(!Call(JsonUtils::Writer().AddString("call", "SQLQuery").AddString("query", query).AddNumber("timeout", timeout), reply, response, timeout)) return false;
+  response = reply["data"];
+  
+  return true;
+  
+}
+
+bool AgentBackend::SQLQuery(const std::string& query, const unsigned int timeout){
+  
+  std::string response;
+  return SQLQuery(query, response, timeout);
+  
+}
+
+bool AgentBackend::SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp){
+  
+  JsonUtils::Writer msg;
+  msg.AddString("message", message).AddNumber("severity", static_cast<int>(severity)).AddString("device", Device(device)).AddNumber("timestamp", timestamp);
+  
+  return m_ring.Send(AgentMessageType::Log, msg.str());
+  
+}
+
+bool AgentBackend::SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp){
+  
+  JsonUtils::Writer msg;
+  msg.AddString("data", json_data).AddString("subject", subject).AddString("device", Device(device)).AddNumber("timestamp", timestamp);
+  
+  return m_ring.Send(AgentMessageType::Monitoring, msg.str());
+  
+}
+
+bool AgentBackend::SendAlarm(const std::string& message, bool critical, const std::string& device, const uint64_t timestamp, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  std::string error;
+  
+  return Call(JsonUtils::Writer().AddString("call", "SendAlarm").AddString("message", message).AddBool("critical", critical).AddString("device", Device(device)).AddNumber("timestamp", timestamp).AddNumber("timeout", timeout), reply, error, timeout, critical);
+  
+}
+
+bool AgentBackend::SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  std::string error;
+  if(!Call(JsonUtils::Writer().AddString("call", "SendCalibrationData").AddString("data", json_data).AddString("description", description).AddString("device", Device(device)).AddNumber("timestamp", timestamp).AddNumber("timeout", timeout), reply, error, timeout)) return false;
+  if(version) *version = GetInt(reply, "version");
+  
+  return true;
+  
+}
+
+bool AgentBackend::GetCalibrationData(std::string& json_data, int& version, const std::string& device, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  if(!Call(JsonUtils::Writer().AddString("call", "GetCalibrationData").AddNumber("version", version).AddString("device", Device(device)).AddNumber("timeout", timeout), reply, json_data, timeout)) return false;
+  json_data = reply["data"];
+  version = GetInt(reply, "version", version);
+  
+  return true;
+  
+}
+
+bool AgentBackend::SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  std::string error;
+  if(!Call(JsonUtils::Writer().AddString("call", "SendDeviceConfig").AddString("data", json_data).AddString("author", author).AddString("description", description).AddString("device", Device(device)).AddNumber("timestamp", timestamp).AddNumber("timeout", timeout), reply, error, timeout)) return false;
+  if(version) *version = GetInt(reply, "version");
+  
+  return true;
+  
+}
+
+bool AgentBackend::GetDeviceConfig(std::string& json_data, const int version, const std::string& device, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  if(!Call(JsonUtils::Writer().AddString("call", "GetDeviceConfig").AddNumber("version", version).AddString("device", Device(device)).AddNumber("timeout", timeout), reply, json_data, timeout)) return false;
+  json_data = reply["data"];
+  
+  return true;
+  
+}
+
+bool AgentBackend::GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  if(!Call(JsonUtils::Writer().AddString("call", "GetRunConfig").AddNumber("base_config_id", base_config_id).AddNumber("runmode_config_id", runmode_config_id).AddNumber("timeout", timeout), reply, json_data, timeout)) return false;
+  json_data = reply["data"];
+  
+  return true;
+  
+}
+
+bool AgentBackend::GetRunModeConfig(std::string& json_data, const std::string& name, const int version, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  if(!Call(JsonUtils::Writer().AddString("call", "GetRunModeConfig").AddString("name", name).AddNumber("version", version).AddNumber("timeout", timeout), reply, json_data, timeout)) return false;
+  json_data = reply["data"];
+  
+  return true;
+  
+}
+
+bool AgentBackend::GetRunDeviceConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, int* version, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  if(!Call(JsonUtils::Writer().AddString("call", "GetDeviceConfigFromRunConfig").AddNumber("base_config_id", base_config_id).AddNumber("runmode_config_id", runmode_config_id).AddString("device", Device(device)).AddNumber("timeout", timeout), reply, json_data, timeout)) return false;
+  json_data = reply["data"];
+  if(version) *version = GetInt(reply, "version");
+  
+  return true;
+  
+}
+
+bool AgentBackend::SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  std::string error;
+  if(!Call(JsonUtils::Writer().AddString("call", "SendROOTplot").AddString("name", plot_name).AddString("draw_options", draw_options).AddString("data", json_data).AddNumber("timestamp", timestamp).AddNumber("lifetime", lifetime).AddNumber("timeout", timeout), reply, error, timeout)) return false;
+  if(version) *version = GetInt(reply, "version");
+  
+  return true;
+  
+}
+
+bool AgentBackend::GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int& version, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  if(!Call(JsonUtils::Writer().AddString("call", "GetROOTplot").AddString("name", plot_name).AddNumber("version", version).AddNumber("timeout", timeout), reply, json_data, timeout)) return false;
+  draw_options = reply["draw_options"];
+  json_data = reply["data"];
+  version = GetInt(reply, "version", version);
+  
+  return true;
+  
+}
+
+bool AgentBackend::SendPlotlyPlot(const std::string& name, const std::string& json_trace, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  std::string error;
+  if(!Call(JsonUtils::Writer().AddString("call", "SendPlotlyPlot").AddString("name", name).AddString("trace", json_trace).AddString("layout", json_layout).AddNumber("timestamp", timestamp).AddNumber("lifetime", lifetime).AddNumber("timeout", timeout), reply, error, timeout)) return false;
+  if(version) *version = GetInt(reply, "version");
+  
+  return true;
+  
+}
+
+bool AgentBackend::SendPlotlyPlot(const std::string& name, const std::vector<std::string>& json_traces, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  std::string error;
+  if(!Call(JsonUtils::Writer().AddString("call", "SendPlotlyPlot").AddString("name", name).AddStrings("traces", json_traces).AddString("layout", json_layout).AddNumber("timestamp", timestamp).AddNumber("lifetime", lifetime).AddNumber("timeout", timeout), reply, error, timeout)) return false;
+  if(version) *version = GetInt(reply, "version");
+  
+  return true;
+  
+}
+
+bool AgentBackend::GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int& version, const unsigned int timeout){
+  
+  std::map<std::string, std::string> reply;
+  if(!Call(JsonUtils::Writer().AddString("call", "GetPlotlyPlot").AddString("name", name).AddNumber("version", version).AddNumber("timeout", timeout), reply, json_trace, timeout)) return false;
+  json_trace = reply["trace"];
+  json_layout = reply["layout"];
+  version = GetInt(reply, "version", version);
+  
+  return true;
+  
+}
@@ -0,0 +1,110 @@
+#include <CallTrace.h>
+#include <algorithm>
+#include <cstring>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  const char trace_magic[8] = {'D','A','Q','T','R','C','1','\0'};
+  
+  uint32_t Clamp(const uint64_t value){
+    
+    return static_cast<uint32_t>(std::min<uint64_t>(value, UINT32_MAX));
+    
+  }
+  
+}
+
+const char* ToolFramework::TraceCallName(const TraceCall call){
+  
+  switch(call){
+  case TraceCall::SQLQuery: return "SQLQuery";
+  case TraceCall::SendLog: return "SendLog";
+  case TraceCall::SendAlarm: return "SendAlarm";
+  case TraceCall::SendMonitoringData: return "SendMonitoringData";
+  case TraceCall::SendCalibrationData: return "SendCalibrationData";
+  case TraceCall::GetCalibrationData: return "GetCalibrationData";
+  case TraceCall::SendDeviceConfig: return "SendDeviceConfig";
+  case TraceCall::GetDeviceConfig: return "GetDeviceConfig";
+  case TraceCall::GetRunConfig: return "GetRunConfig";
+  case TraceCall::GetRunModeConfig: return "GetRunModeConfig";
+  case TraceCall::GetRunDeviceConfig: return "GetRunDeviceConfig";
+  case TraceCall::SendROOTplot: return "SendROOTplot";
+  case TraceCall::GetROOTplot: return "GetROOTplot";
+  case TraceCall::SendPlotlyPlot: return "SendPlotlyPlot";
+  case TraceCall::GetPlotlyPlot: return "GetPlotlyPlot";
+  }
+  
+  return "unknown";
+  
+}
+
+CallTrace::CallTrace(){}
+
+CallTrace::~CallTrace(){
+  
+  Close();
+  
+}
+
+bool CallTrace::Open(const std::string& path){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  
+  m_file.open(path, std::ios::binary | std::ios::trunc);
+  if(!m_file) return false;
+  
+  m_start = std::chrono::steady_clock::now();
+  uint64_t start_epoch_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  m_file.write(trace_magic, sizeof(trace_magic));
+  m_file.write(reinterpret_cast<const char*>(&start_epoch_us), sizeof(start_epoch_us));
+  
+  return m_file.good();
+  
+}
+
+void CallTrace::Record(const TraceCall call, const std::chrono::steady_clock::time_point start, const size_t request_bytes, const size_t reply_bytes, const unsigned int timeout_ms, const bool ok){
+  
+  TraceRecord record;
+  memset(&record, 0, sizeof(record));
+  record.time_us = std::chrono::duration_cast<std::chrono::microseconds>(start - m_start).count();
+  record.request_bytes = Clamp(request_bytes);
+  record.reply_bytes = Clamp(reply_bytes);
+  record.timeout_ms = timeout_ms;
+  record.latency_us = Clamp(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+  record.call = call;
+  record.ok = ok;
+  
+  // ofstream buffers, so this is a memcpy most of the time
+  std::lock_guard<std::mutex> lock(m_mtx);
+  if(m_file.is_open()) m_file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+  
+}
+
+void CallTrace::Close(){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  if(m_file.is_open()) m_file.close();
+  
+}
+
+bool CallTrace::Read(const std::string& path, std::vector<TraceRecord>& records, uint64_t* start_epoch_us){
+  
+  records.clear();
+  std::ifstream file(path, std::ios::binary);
+  char magic[sizeof(trace_magic)];
+  uint64_t start;
+  if(!file.read(magic, sizeof(magic)) || memcmp(magic, trace_magic, sizeof(magic))!=0) return false;
+  if(!file.read(reinterpret_cast<char*>(&start), sizeof(start))) return false;
+  if(start_epoch_us) *start_epoch_us = start;
+  
+  TraceRecord record;
+  while(file.read(reinterpret_cast<char*>(&record), sizeof(record))) records.push_back(record);
+  
+  // records are written as calls complete; order them by start time
+  std::stable_sort(records.begin(), records.end(), [](const TraceRecord& a, const TraceRecord& b){ return a.time_us<b.time_us; });
+  
+  return true;
+  
+}
@@ -1,38 +1,274 @@
 #include <DAQInterface.h>
+#include <JsonUtils.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
+#include <climits>
+#include <fstream>
 
 using namespace ToolFramework;
 
+namespace {
+  
+  struct SlowControlSpec{
+    std::string name;
+    SlowControlElementType type;
+    std::map<std::string, double> limits; // min, max, step
+    std::string value;
+    bool has_value=false;
+    std::vector<std::string> options;
+    std::function<std::string(const char*)> change_function=nullptr;
+    std::function<std::string(const char*)> read_function=nullptr;
+  };
+  
+  bool ParseSlowControlType(const std::string& name, SlowControlElementType& type){
+    
+    if(name=="BUTTON") type=BUTTON;
+    else if(name=="VARIABLE") type=VARIABLE;
+    else if(name=="OPTIONS") type=OPTIONS;
+    else if(name=="COMMAND") type=COMMAND;
+    else if(name=="INFO") type=INFO;
+    else return false;
+    
+    return true;
+    
+  }
+  
+  // single quotes doubled, for string literals in generated SQL
+  bool IsSchemaError(const std::string& error){ // PostgreSQL and SQLite wording for a missing table or column
+    
+    std::string lower(error);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c){ return std::tolower(c); });
+    if(lower.find("no such table")!=std::string::npos || lower.find("no such column")!=std::string::npos) return true;
+    return lower.find("does not exist")!=std::string::npos &&
+      (lower.find("relation")!=std::string::npos || lower.find("column")!=std::string::npos);
+    
+  }
+  
+  std::string QuoteSQL(const std::string& in){
+    
+    std::string out = "'";
+    for(const char c : in){
+      if(c=='\'') out+='\'';
+      out+=c;
+    }
+    out+='\'';
+    
+    return out;
+    
+  }
+  
+  bool ParseNumber(const std::string& in, double& out){
+    
+    char* end=nullptr;
+    out=std::strtod(in.c_str(), &end);
+    return end!=in.c_str() && *end=='\0';
+    
+  }
+  
+}
+
 DAQInterface::DAQInterface(std::string configuration_file){
 
+  m_configuration_file = configuration_file;
   vars.Initialise(configuration_file);
   if(!vars.Get("device_name",m_name)) m_name = "unnamed";
   vars.Set("service_name",m_name);
-
-  boost::uuids::uuid m_UUID;
-  std::string s_uuid;
-  if(vars.Get("UUID",s_uuid)){
-    m_UUID = boost::uuids::string_generator{}(s_uuid);
-  } else {
-    m_UUID = boost::uuids::random_generator()();
+  bool verbose=false;
+  vars.Get("verbosity",verbose);
+  m_verbose=verbose;
+  bool run_config_cache=false;
+  vars.Get("run_config_cache",run_config_cache);
+  m_run_config_cache_enabled=run_config_cache;
+  unsigned int probe_timeout_ms=m_probe_timeout_ms;
+  vars.Get("probe_timeout_ms",probe_timeout_ms);
+  m_probe_timeout_ms=probe_timeout_ms;
+  
+  // spans go to a Chrome trace JSON file; 1 in span_trace_sample_every outermost calls is traced
+  std::string span_trace_file;
+  if(vars.Get("span_trace_file",span_trace_file) && span_trace_file!=""){
+    unsigned int sample_every=1;
+    vars.Get("span_trace_sample_every",sample_every);
+    m_span_tracer = new SpanTracer(sample_every);
+    if(!m_span_tracer->Open(span_trace_file)){
+      std::cerr<<"DAQInterface: could not open span trace file '"<<span_trace_file<<"', spans will not be recorded"<<std::endl;
+      delete m_span_tracer;
+      m_span_tracer=nullptr;
+    }
+  }
+  
+  // either serve everything locally for load tests, from a local database file, hand everything to a node-local agent, or connect to the network ourselves
+  bool stand_in=false;
+  vars.Get("stand_in_backend",stand_in);
+  std::string local_db;
+  std::string local_agent;
+  if(stand_in){
+    unsigned int workers=8;
+    unsigned int latency_us=500;
+    vars.Get("stand_in_workers",workers);
+    vars.Get("stand_in_latency_us",latency_us);
+    m_backend = new StandInBackend(workers, latency_us);
+  }
+  else if(vars.Get("local_db",local_db) && local_db!=""){
+    // with local_db_sync, writes are also replayed to the central database whenever it can be reached
+    bool sync=false;
+    unsigned int sync_period_s=60;
+    vars.Get("local_db_sync",sync);
+    vars.Get("local_db_sync_s",sync_period_s);
+    LocalDBBackend* local = new LocalDBBackend(m_name, sync ? new NetworkBackend(vars, &sc_vars, m_span_tracer) : nullptr, sync_period_s);
+    std::string error;
+    if(local->Open(local_db, error)) m_backend = local;
+    else {
+      std::cerr<<"DAQInterface: could not open local database '"<<local_db<<"': "<<error<<", connecting directly"<<std::endl;
+      delete local;
+    }
   }
+  else if(vars.Get("local_agent",local_agent) && local_agent!=""){
+    AgentBackend* agent = new AgentBackend(m_name);
+    if(agent->Connect(local_agent)){
+      m_backend = agent;
+      m_local_agent = true;
+    }
+    else {
+      std::cerr<<"DAQInterface: could not open local agent ring '"<<local_agent<<"', connecting directly"<<std::endl;
+      delete agent;
+    }
+  }
+  if(!m_backend) m_backend = new NetworkBackend(vars, &sc_vars, m_span_tracer);
+  
+  std::string trace_file;
+  vars.Get("trace_file",trace_file);
+  if(trace_file!="" || m_span_tracer){
+    TracingBackend* tracing = new TracingBackend(m_backend);
+    if(trace_file!="" && !tracing->Open(trace_file)) std::cerr<<"DAQInterface: could not open trace file '"<<trace_file<<"', calls will not be recorded"<<std::endl;
+    tracing->SetSpanTracer(m_span_tracer);
+    m_backend = tracing;
+  }
+  
+  unsigned int monitoring_window_ms=1000;
+  unsigned int monitoring_max_fields=1024;
+  vars.Get("monitoring_window_ms",monitoring_window_ms);
+  vars.Get("monitoring_max_fields",monitoring_max_fields);
+  size_t multicast_queue_size=4096;
+  size_t multicast_max_payload=0;
+  unsigned int multicast_block_ms=100;
+  vars.Get("multicast_queue_size",multicast_queue_size);
+  vars.Get("multicast_max_payload",multicast_max_payload);
+  vars.Get("multicast_block_ms",multicast_block_ms);
+  m_multicast = new MulticastSender(m_backend, multicast_queue_size, multicast_max_payload, multicast_block_ms);
+  
+  unsigned int max_in_flight=8;
+  vars.Get("max_in_flight",max_in_flight);
+  m_pipeline = new RequestPipeline(max_in_flight, m_span_tracer);
   
-  m_context = new zmq::context_t(1);
-  mp_SD = new ServiceDiscovery(true, false, 60000, "239.192.1.1", 5000, m_context,m_UUID, m_name, 5, 60);
+  m_aggregator = new MonitoringAggregator([this](const std::string& json_data, const std::string& subject){ return m_multicast->SendMonitoringData(json_data, subject); }, monitoring_window_ms, monitoring_max_fields);
   
-  m_services= new Services();
-  m_services->Init(vars, m_context, &sc_vars);
+  unsigned int monitoring_schema_announce_s=60;
+  vars.Get("monitoring_schema_announce_s",monitoring_schema_announce_s);
+  m_monitoring_schema = new MonitoringSchema([this](std::string&& json_data, const std::string& subject){ return m_multicast->SendMonitoringData(std::move(json_data), subject); }, monitoring_schema_announce_s);
+  
+  size_t plot_cache_mb=64;
+  vars.Get("plot_cache_mb",plot_cache_mb);
+  bool plot_version_probe=true;
+  vars.Get("plot_version_probe",plot_version_probe);
+  m_plot_version_probe.Reset(plot_version_probe);
+  vars.Get("root_plot_table",m_root_plot_table);
+  vars.Get("plotly_plot_table",m_plotly_plot_table);
+  vars.Get("calibration_table",m_calibration_table);
+  vars.Get("device_config_table",m_device_config_table);
+  bool multi_device_query=false;
+  vars.Get("multi_device_query",multi_device_query);
+  m_multi_device_query=multi_device_query;
+  if(plot_cache_mb) m_plot_cache = new PlotCache(plot_cache_mb*1024*1024);
+  
+  // lets remote consumers pull deltas: the command's argument is the last version they have
+  bool sc_changes_command=false;
+  vars.Get("sc_changes_command",sc_changes_command);
+  if(sc_changes_command && !m_local_agent){
+    m_sc_changelog.Ignore("sc_changes");
+    sc_vars.Add("sc_changes", COMMAND, [this](const char* value){
+      std::string json_data;
+      return GetSlowControlChanges(json_data, value ? std::strtoull(value, nullptr, 10) : 0) ? json_data : std::string("{\"error\":\"could not read slow controls\"}");
+    });
+  }
+  
+  unsigned int sc_history_period_ms=1000;
+  vars.Get("sc_history_period_ms",sc_history_period_ms);
+  m_sc_history = new SlowControlHistory([this](const std::string& name, double& value){
+    std::lock_guard<std::recursive_mutex> lock(m_sc_mtx);
+    SlowControlElement* element = sc_vars[name];
+    return element && element->GetValue<double>(value);
+  }, sc_history_period_ms);
+  
+  bool upload_dedup=false;
+  vars.Get("upload_dedup",upload_dedup);
+  if(upload_dedup){
+    unsigned int refresh_s=3600;
+    vars.Get("upload_dedup_refresh_s",refresh_s);
+    m_dedup = new UploadDeduplicator(refresh_s);
+  }
+  
+  bool reliable_logging=false;
+  vars.Get("reliable_logging",reliable_logging);
+  if(reliable_logging){
+    size_t queue_size=10000;
+    size_t batch_size=500;
+    unsigned int block_ms=1000;
+    std::string spool_file;
+    std::string table="logging";
+    int reliable_log_severity=m_reliable_log_severity;
+    vars.Get("reliable_log_severity",reliable_log_severity);
+    m_reliable_log_severity=reliable_log_severity;
+    vars.Get("reliable_log_queue_size",queue_size);
+    vars.Get("reliable_log_batch_size",batch_size);
+    vars.Get("reliable_log_block_ms",block_ms);
+    vars.Get("reliable_log_spool",spool_file);
+    vars.Get("reliable_log_table",table);
+    // the table's names for the (time, device, severity, message) columns, comma separated
+    std::vector<std::string> columns={"time", "device", "severity", "message"};
+    std::string column_list;
+    if(vars.Get("reliable_log_columns",column_list)){
+      std::vector<std::string> names;
+      for(size_t start=0, end=0; end!=std::string::npos; start=end+1){
+        end = column_list.find(',', start);
+        names.push_back(column_list.substr(start, end==std::string::npos ? end : end-start));
+      }
+      if(names.size()==columns.size() && std::find(names.begin(), names.end(), "")==names.end()) columns.swap(names);
+      else std::cerr<<"DAQInterface: 'reliable_log_columns "<<column_list<<"' should name 4 columns (time,device,severity,message), using the defaults"<<std::endl;
+    }
+    m_reliable_logger = new ReliableLogger([this, table, columns](const std::vector<SQLRow>& rows, std::string& error){
+      std::vector<std::string> errors;
+      bool ok = SQLBulkInsert(table, columns, rows, &errors, rows.size());
+      if(!ok && !errors.empty()) error = errors.front();
+      return ok;
+    }, m_name, queue_size, batch_size, spool_file, block_ms);
+  }
   
   
 }
  
 DAQInterface::~DAQInterface(){
   
-  delete m_services;
-  m_services=0;
-  delete mp_SD;
-  mp_SD=0;
-  delete m_context;
-  m_context=0;
+  delete m_sc_history; // its sampler reads sc_vars
+  m_sc_history=0;
+  delete m_reliable_logger; // flushes or spools anything not yet acknowledged
+  m_reliable_logger=0;
+  delete m_aggregator; // flushes the last window, so must go before the backend
+  m_aggregator=0;
+  delete m_monitoring_schema;
+  m_monitoring_schema=0;
+  delete m_pipeline; // likewise waits for outstanding requests
+  m_pipeline=0;
+  delete m_multicast; // and drains queued logs and monitoring data
+  m_multicast=0;
+  delete m_backend;
+  m_backend=0;
+  delete m_dedup;
+  m_dedup=0;
+  delete m_plot_cache;
+  m_plot_cache=0;
+  delete m_span_tracer; // last, everything above may still record spans as it shuts down
+  m_span_tracer=0;
   
 }
 
@@ -41,6 +277,96 @@ void DAQInterface::SetVerbose(bool in){
 	return;
 }
 
+bool DAQInterface::ReloadConfig(std::vector<std::string>* restart_needed, const std::string& configuration_file){
+  
+  std::lock_guard<std::mutex> lock(m_reload_mtx);
+  if(restart_needed) restart_needed->clear();
+  
+  std::string file = configuration_file!="" ? configuration_file : m_configuration_file;
+  std::ifstream check(file);
+  if(!check.good()){
+    if(m_verbose) std::cerr<<"ReloadConfig: could not read '"<<file<<"'"<<std::endl;
+    return false;
+  }
+  check.close();
+  m_configuration_file = file; // later reloads read the new file
+  
+  Store fresh;
+  fresh.Initialise(file);
+  fresh.Set("service_name",m_name);
+  
+  // fixed when the interface was built; report them rather than half apply them
+  static const char* fixed_keys[]={"device_name", "UUID", "calibration_table", "device_config_table", "stand_in_backend", "stand_in_workers", "stand_in_latency_us", "local_db", "local_db_sync", "local_agent", "trace_file", "span_trace_file",
+                                   "span_trace_sample_every", "multicast_queue_size", "multicast_max_payload", "multicast_block_ms", "max_in_flight", "monitoring_max_fields",
+                                   "monitoring_schema_announce_s", "plot_cache_mb", "root_plot_table", "plotly_plot_table", "sc_changes_command", "sc_history_period_ms",
+                                   "upload_dedup", "upload_dedup_refresh_s", "reliable_logging", "reliable_log_queue_size", "reliable_log_batch_size",
+                                   "reliable_log_block_ms", "reliable_log_spool", "reliable_log_table", "reliable_log_columns"};
+  bool all_applied=true;
+  for(const char* key : fixed_keys){
+    std::string before;
+    std::string after;
+    vars.Get(key,before);
+    fresh.Get(key,after);
+    if(before==after) continue;
+    all_applied=false;
+    fresh.Set(key,before);
+    if(restart_needed) restart_needed->push_back(key);
+    if(m_verbose) std::cerr<<"ReloadConfig: '"<<key<<"' only takes effect when the DAQInterface is reconstructed"<<std::endl;
+  }
+  
+  bool verbose=m_verbose;
+  fresh.Get("verbosity",verbose);
+  m_verbose=verbose;
+  
+  bool run_config_cache=m_run_config_cache_enabled;
+  fresh.Get("run_config_cache",run_config_cache);
+  if(!run_config_cache) ClearRunConfigCache();
+  if(run_config_cache && !m_run_config_cache_enabled) m_run_config_probe.Reset(true); // switching it back on retries a probe that gave up
+  m_run_config_cache_enabled=run_config_cache;
+  
+  unsigned int probe_timeout_ms=m_probe_timeout_ms;
+  fresh.Get("probe_timeout_ms",probe_timeout_ms);
+  m_probe_timeout_ms=probe_timeout_ms;
+  
+  bool plot_version_probe=true;
+  fresh.Get("plot_version_probe",plot_version_probe);
+  m_plot_version_probe.Reset(plot_version_probe); // also retries a probe that switched itself off
+  
+  bool multi_device_query=false;
+  fresh.Get("multi_device_query",multi_device_query);
+  m_multi_device_query=multi_device_query;
+  
+  unsigned int monitoring_window_ms=m_aggregator->GetWindow();
+  fresh.Get("monitoring_window_ms",monitoring_window_ms);
+  if(monitoring_window_ms!=m_aggregator->GetWindow()) m_aggregator->SetWindow(monitoring_window_ms);
+  
+  int reliable_log_severity=m_reliable_log_severity;
+  fresh.Get("reliable_log_severity",reliable_log_severity);
+  m_reliable_log_severity=reliable_log_severity;
+  
+  // transport settings: a backend that can't apply them in place (agent, stand-in, local database) has them
+  // reported, so they aren't silently ignored
+  if(!m_backend->Reload(fresh)){
+    std::vector<std::string> backend_keys = NetworkBackend::ReloadKeys();
+    backend_keys.push_back("local_db_sync_s");
+    for(const std::string& key : backend_keys){
+      std::string before;
+      std::string after;
+      vars.Get(key,before);
+      fresh.Get(key,after);
+      if(before==after) continue;
+      all_applied=false;
+      fresh.Set(key,before);
+      if(restart_needed) restart_needed->push_back(key);
+      if(m_verbose) std::cerr<<"ReloadConfig: '"<<key<<"' can't be changed in place with this backend; restart it (or the local agent) to apply it"<<std::endl;
+    }
+  }
+  vars = fresh;
+  
+  return all_applied;
+  
+}
+
 
 // ===========================================================================
 // Write Functions
@@ -48,19 +374,37 @@ void DAQInterface::SetVerbose(bool in){
 
 bool DAQInterface::SendAlarm(const std::string& message, bool critical, const std::string& device, const uint64_t timestamp, const unsigned int timeout){
   
-  return m_services->SendAlarm(message, critical, device, timestamp, timeout);
+  SpanTracer::Scope span(m_span_tracer, "SendAlarm");
+  return m_backend->SendAlarm(message, critical, device, timestamp, timeout);
   
 }
 
 bool DAQInterface::SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
   
-  return m_services->SendCalibrationData(json_data, description, device, timestamp, version, timeout);
+  SpanTracer::Scope span(m_span_tracer, "SendCalibrationData");
+  std::string key = "calibration:"+(device.empty() ? m_name : device);
+  // an explicit timestamp makes it a different upload, even with the same content
+  uint64_t hash = m_dedup ? UploadDeduplicator::Hash({json_data, description, std::to_string(timestamp)}) : 0;
+  if(m_dedup && m_dedup->IsDuplicate(key, hash, json_data.size(), version)) return true;
+  
+  if(!m_backend->SendCalibrationData(json_data, description, device, timestamp, version, timeout)) return false;
+  if(m_dedup) m_dedup->Sent(key, hash, version ? *version : -1);
+  
+  return true;
   
 }
 
 bool DAQInterface::SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
   
-  return m_services->SendDeviceConfig(json_data, author, description, device, timestamp, version, timeout);
+  SpanTracer::Scope span(m_span_tracer, "SendDeviceConfig");
+  std::string key = "device_config:"+(device.empty() ? m_name : device);
+  uint64_t hash = m_dedup ? UploadDeduplicator::Hash({json_data, author, description, std::to_string(timestamp)}) : 0;
+  if(m_dedup && m_dedup->IsDuplicate(key, hash, json_data.size(), version)) return true;
+  
+  if(!m_backend->SendDeviceConfig(json_data, author, description, device, timestamp, version, timeout)) return false;
+  if(m_dedup) m_dedup->Sent(key, hash, version ? *version : -1);
+  
+  return true;
   
 }
 
@@ -70,88 +414,516 @@ bool DAQInterface::SendDeviceConfig(const std::string& json_data, const std::str
 
 bool DAQInterface::GetCalibrationData(std::string& json_data, int& version, const std::string& device, const unsigned int timeout){
   
-  return m_services->GetCalibrationData(json_data, version, device, timeout);
+  SpanTracer::Scope span(m_span_tracer, "GetCalibrationData");
+  return m_backend->GetCalibrationData(json_data, version, device, timeout);
   
 }
 
 bool DAQInterface::GetCalibrationData(std::string& json_data, int&& version, const std::string& device, const unsigned int timeout){
 
-  return m_services->GetCalibrationData(json_data, version, device, timeout);
+  SpanTracer::Scope span(m_span_tracer, "GetCalibrationData");
+  return m_backend->GetCalibrationData(json_data, version, device, timeout);
   
 }
 
 bool DAQInterface::GetDeviceConfig(std::string& json_data, int version, const std::string& device, const unsigned int timeout){
   
-  return m_services->GetDeviceConfig(json_data, version, device, timeout);
+  SpanTracer::Scope span(m_span_tracer, "GetDeviceConfig");
+  return m_backend->GetDeviceConfig(json_data, version, device, timeout);
+  
+}
+
+bool DAQInterface::GetCalibrationData(std::vector<DeviceData>& items, const unsigned int timeout){
+  
+  SpanTracer::Scope span(m_span_tracer, "GetCalibrationDataMulti");
+  return span.Ok(GetDeviceDataMulti(m_calibration_table, items, false, timeout));
+  
+}
+
+bool DAQInterface::GetDeviceConfig(std::vector<DeviceData>& items, const unsigned int timeout){
+  
+  SpanTracer::Scope span(m_span_tracer, "GetDeviceConfigMulti");
+  return span.Ok(GetDeviceDataMulti(m_device_config_table, items, true, timeout));
+  
+}
+
+bool DAQInterface::GetDeviceDataMulti(const std::string& table, std::vector<DeviceData>& items, const bool config, const unsigned int timeout){
+  
+  if(items.empty()) return true;
+  
+  for(DeviceData& item : items){
+    item.ok=false;
+    item.error.clear();
+    item.json_data.clear();
+  }
+  if(m_multi_device_query && GetDeviceDataQuery(table, items, config, timeout)) return true;
+  
+  // one calibration/config request per key, pipelined, so the middleman keeps ownership of the schema.
+  // each request gets the whole timeout for itself; time queued behind earlier items of the batch doesn't count,
+  // so the batch may take up to ceil(items/window) timeouts
+  size_t pending=0;
+  for(const DeviceData& item : items) pending += !item.ok;
+  unsigned int window = std::max(1u, m_pipeline->GetWindow());
+  uint64_t queued_budget = uint64_t(timeout)*((pending+window-1)/window);
+  unsigned int budget = std::min<uint64_t>(queued_budget, UINT_MAX);
+  std::vector<std::future<bool> > results;
+  for(DeviceData& item : items){
+    if(item.ok) continue; // already found by the batched query
+    results.push_back(m_pipeline->Submit([this, &item, config, timeout](const unsigned int remaining){
+      unsigned int own = std::min(remaining, timeout);
+      return config ? m_backend->GetDeviceConfig(item.json_data, item.version, item.device, own) : m_backend->GetCalibrationData(item.json_data, item.version, item.device, own);
+    }, budget));
+  }
+  bool all_ok=true;
+  size_t next=0;
+  for(DeviceData& item : items){
+    if(item.ok) continue;
+    item.error.clear();
+    item.ok = results[next++].get();
+    if(!item.ok){
+      item.error = item.json_data.empty() ? "request failed" : item.json_data;
+      item.json_data.clear();
+      all_ok=false;
+    }
+  }
+  
+  return all_ok;
+  
+}
+
+bool DAQInterface::GetDeviceDataQuery(const std::string& table, std::vector<DeviceData>& items, const bool config, const unsigned int timeout){
+  
+  // one row per key, in key order: the requested version, or the latest, or nulls if there's no match
+  std::string keys;
+  for(size_t i=0; i<items.size(); ++i){
+    if(i) keys+=',';
+    keys += "("+std::to_string(i)+","+QuoteSQL(items[i].device.empty() ? m_name : items[i].device)+","+std::to_string(items[i].version)+")";
+  }
+  std::string query = "SELECT k.idx, t.version, t.data FROM (VALUES "+keys+") AS k(idx, device, version) "
+                      "LEFT JOIN LATERAL (SELECT c.version, c.data FROM "+table+" c WHERE c.device=k.device AND (k.version<0 OR c.version=k.version) "
+                      "ORDER BY c.version DESC LIMIT 1) t ON true ORDER BY k.idx";
+  
+  std::vector<std::string> rows;
+  if(!m_backend->SQLQuery(query, rows, timeout) || rows.size()!=items.size()){
+    // the table isn't reachable by query (or isn't laid out as expected): the caller fetches each key instead
+    if(m_verbose) std::cerr<<"GetDeviceDataMulti: batched query on '"<<table<<"' failed, fetching "<<items.size()<<" items individually"<<std::endl;
+    return false;
+  }
+  
+  bool all_ok=true;
+  std::vector<std::pair<std::string, std::string_view> > members;
+  for(size_t i=0; i<rows.size(); ++i){
+    DeviceData& item = items[i];
+    std::string_view version;
+    std::string_view data;
+    if(JsonUtils::SplitObject(rows[i], members)){
+      for(const std::pair<std::string, std::string_view>& member : members){
+        if(member.first=="version") version = member.second;
+        else if(member.first=="data") data = member.second;
+      }
+    }
+    if(version.empty() || JsonUtils::IsNull(version)){
+      item.error = "no "+std::string(config ? "device config" : "calibration data")+" for '"+(item.device.empty() ? m_name : item.device)+"'"+(item.version>=0 ? " version "+std::to_string(item.version) : "");
+      all_ok=false;
+      continue;
+    }
+    item.version = std::atoi(std::string(JsonUtils::Trim(version)).c_str());
+    item.json_data = JsonUtils::IsString(data) ? JsonUtils::Unquote(data) : std::string(JsonUtils::Trim(data));
+    item.ok=true;
+  }
+  
+  return all_ok;
   
 }
 
 bool DAQInterface::GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout){
   
-  return m_services->GetRunConfig(json_data, base_config_id, runmode_config_id, timeout);
+  SpanTracer::Scope span(m_span_tracer, "GetRunConfig");
+  std::string hash;
+  if(m_run_config_cache_enabled) GetRunConfigHash(base_config_id, runmode_config_id, hash, timeout);
+  
+  return FetchRunConfig(json_data, base_config_id, runmode_config_id, hash, timeout);
+  
+}
+
+bool DAQInterface::GetRunConfigIfChanged(std::string& json_data, const int base_config_id, const int runmode_config_id, std::string& hash, bool& changed, const unsigned int timeout){
+  
+  SpanTracer::Scope span(m_span_tracer, "GetRunConfigIfChanged");
+  std::string current_hash;
+  if(m_run_config_cache_enabled) GetRunConfigHash(base_config_id, runmode_config_id, current_hash, timeout);
+  if(!current_hash.empty() && current_hash==hash){
+    changed=false;
+    return true;
+  }
+  
+  std::string new_json;
+  if(!FetchRunConfig(new_json, base_config_id, runmode_config_id, current_hash, timeout)) return false;
+  if(current_hash.empty()){
+    // no probe: compare the fetched config itself, which costs the full fetch but still spares the caller
+    current_hash = "local:"+std::to_string(std::hash<std::string>{}(new_json));
+    if(current_hash==hash){
+      changed=false;
+      return true;
+    }
+  }
+  json_data = new_json;
+  hash = current_hash;
+  changed=true;
+  
+  return true;
+  
+}
+
+bool DAQInterface::FetchRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& hash, const unsigned int timeout){
+  
+  SpanTracer::Scope span(m_span_tracer, "run_config_fetch", "cache");
+  if(hash.empty()) return m_backend->GetRunConfig(json_data, base_config_id, runmode_config_id, timeout);
+  
+  std::pair<int, int> key{base_config_id, runmode_config_id};
+  {
+    std::lock_guard<std::mutex> lock(m_run_config_cache_mtx);
+    std::map<std::pair<int, int>, std::pair<std::string, std::string> >::iterator it = m_run_config_cache.find(key);
+    if(it!=m_run_config_cache.end() && it->second.first==hash){
+      json_data = it->second.second;
+      return true;
+    }
+  }
+  
+  if(!m_backend->GetRunConfig(json_data, base_config_id, runmode_config_id, timeout)) return false;
+  
+  std::lock_guard<std::mutex> lock(m_run_config_cache_mtx);
+  m_run_config_cache[key] = {hash, json_data};
+  
+  return true;
+  
+}
+
+bool DAQInterface::GetRunConfigHash(const int base_config_id, const int runmode_config_id, std::string& hash, const unsigned int timeout){
+  
+  SpanTracer::Scope span(m_span_tracer, "run_config_probe", "cache");
+  // a changed base or runmode config changes the merged result; the reply is a single 32 character hash
+  std::string query = "SELECT md5(b.data::text || '|' || r.data::text) AS hash FROM base_config b, runmode_config r "
+                      "WHERE b.config_id="+std::to_string(base_config_id)+" AND r.config_id="+std::to_string(runmode_config_id);
+  std::string response;
+  hash.clear();
+  if(!ProbeQuery(query, response, timeout, m_run_config_probe)) return false;
+  
+  std::vector<std::pair<std::string, std::string_view> > members;
+  if(!JsonUtils::SplitObject(response, members) || members.size()!=1 || !JsonUtils::IsString(members.front().second)){
+    m_run_config_probe.enabled=false;
+    return false;
+  }
+  hash = JsonUtils::Unquote(members.front().second);
+  
+  return !hash.empty();
+  
+}
+
+bool DAQInterface::ProbeQuery(const std::string& query, std::string& response, const unsigned int timeout, ProbeState& probe){
+  
+  if(!probe.enabled) return false;
+  int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  if(now < probe.retry_at_ms) return false;
+  unsigned int probe_timeout = std::min<unsigned int>(timeout, m_probe_timeout_ms);
+  if(m_backend->Probe(query, response, probe_timeout) && !response.empty()){
+    probe.failures=0;
+    return true;
+  }
+  
+  // a query the database rejects for want of a table or column won't work until the schema changes;
+  // anything else (a timeout, a busy middleman, a dropped connection) is worth trying again later
+  if(IsSchemaError(response)){
+    probe.enabled=false;
+    if(m_verbose) std::cerr<<"DAQInterface: disabling probe query after error '"<<response<<"': "<<query<<std::endl;
+  }
+  else {
+    unsigned int failures = std::min<unsigned int>(++probe.failures, 7);
+    probe.retry_at_ms = now + (int64_t(1000)<<(failures-1)); // 1 s doubling to 64 s
+  }
+  
+  return false;
+  
+}
+
+void DAQInterface::ClearRunConfigCache(){
+  
+  std::lock_guard<std::mutex> lock(m_run_config_cache_mtx);
+  m_run_config_cache.clear();
+  m_run_device_config_cache.clear();
   
 }
 
 bool DAQInterface::GetRunModeConfig(std::string& json_data, const std::string& name, int version, const unsigned int timeout){
   
-  return m_services->GetRunModeConfig(json_data, name, version, timeout);
+  SpanTracer::Scope span(m_span_tracer, "GetRunModeConfig");
+  return m_backend->GetRunModeConfig(json_data, name, version, timeout);
   
 }
 
 bool DAQInterface::GetDeviceConfigFromRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, const unsigned int timeout){
   
-  return m_services->GetRunDeviceConfig(json_data, base_config_id, runmode_config_id, device, nullptr, timeout);
+  SpanTracer::Scope span(m_span_tracer, "GetDeviceConfigFromRunConfig");
+  std::string hash;
+  if(!m_run_config_cache_enabled || !GetRunConfigHash(base_config_id, runmode_config_id, hash, timeout)){
+    return m_backend->GetRunDeviceConfig(json_data, base_config_id, runmode_config_id, device, nullptr, timeout);
+  }
+  
+  std::tuple<int, int, std::string> key{base_config_id, runmode_config_id, device};
+  {
+    std::lock_guard<std::mutex> lock(m_run_config_cache_mtx);
+    std::map<std::tuple<int, int, std::string>, std::pair<std::string, std::string> >::iterator it = m_run_device_config_cache.find(key);
+    if(it!=m_run_device_config_cache.end() && it->second.first==hash){
+      json_data = it->second.second;
+      return true;
+    }
+  }
+  
+  if(!m_backend->GetRunDeviceConfig(json_data, base_config_id, runmode_config_id, device, nullptr, timeout)) return false;
+  
+  std::lock_guard<std::mutex> lock(m_run_config_cache_mtx);
+  m_run_device_config_cache[key] = {hash, json_data};
+  
+  return true;
   
 }
 
 /*
 bool DAQInterface::GetDeviceConfigFromRunConfig(std::string& json_data, const std::string& runconfig_name, const int runconfig_version, const std::string& device, const unsigned int timeout){
   
-  return m_services->GetRunDeviceConfig(json_data, runconfig_name, runconfig_version, device, nullptr, timeout);
+  return m_backend->GetRunDeviceConfig(json_data, runconfig_name, runconfig_version, device, nullptr, timeout);
   
 }
 */
 
 bool DAQInterface::GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int& version, const unsigned int timeout){
   
-  return m_services->GetROOTplot(plot_name, draw_options, json_data, version, timeout);
+  SpanTracer::Scope span(m_span_tracer, "GetROOTplot");
+  // specific versions never change, so only "latest" needs the version probe
+  std::string key = "root_plot:"+plot_name;
+  int wanted = version;
+  if(m_plot_cache && (wanted>=0 || LatestPlotVersion(m_root_plot_table, plot_name, wanted, timeout)) && m_plot_cache->Get(key, wanted, draw_options, json_data)){
+    version = wanted;
+    return true;
+  }
+  
+  if(!m_backend->GetROOTplot(plot_name, draw_options, json_data, version, timeout)) return false;
+  if(m_plot_cache && version>=0) m_plot_cache->Put(key, version, draw_options, json_data);
+  
+  return true;
   
 }
 
 bool DAQInterface::GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int&& version, const unsigned int timeout){
   
-  return m_services->GetROOTplot(plot_name, draw_options, json_data, version, timeout);
+  return GetROOTplot(plot_name, draw_options, json_data, version, timeout);
   
 }
 
 bool DAQInterface::GetPlotlyPlot(const std::string& name, std::string& trace, std::string& layout, int& version, unsigned int timeout) {
-
-  return m_services->GetPlotlyPlot(name, trace, layout, version, timeout);
+  
+  SpanTracer::Scope span(m_span_tracer, "GetPlotlyPlot");
+  std::string key = "plotly_plot:"+name;
+  int wanted = version;
+  if(m_plot_cache && (wanted>=0 || LatestPlotVersion(m_plotly_plot_table, name, wanted, timeout)) && m_plot_cache->Get(key, wanted, trace, layout)){
+    version = wanted;
+    return true;
+  }
+  
+  if(!m_backend->GetPlotlyPlot(name, trace, layout, version, timeout)) return false;
+  if(m_plot_cache && version>=0) m_plot_cache->Put(key, version, trace, layout);
+  
+  return true;
   
 }
 
 bool DAQInterface::GetPlotlyPlot(const std::string& name, std::string& trace, std::string& layout, int&& version, unsigned int timeout) {
+  
+  return GetPlotlyPlot(name, trace, layout, version, timeout);
+  
+}
+
+bool DAQInterface::LatestPlotVersion(const std::string& table, const std::string& name, int& version, const unsigned int timeout){
+  
+  SpanTracer::Scope span(m_span_tracer, "plot_version_probe", "cache");
+  // a failed probe just means the plot is fetched in full as before; one the database rejects
+  // (e.g. no such table) switches probing off rather than costing every later fetch a round trip
+  std::string query = "SELECT max(version) AS version FROM "+table+" WHERE name="+QuoteSQL(name);
+  std::string response;
+  if(!ProbeQuery(query, response, timeout, m_plot_version_probe)) return false;
+  
+  std::vector<std::pair<std::string, std::string_view> > members;
+  if(!JsonUtils::SplitObject(response, members) || members.size()!=1){
+    m_plot_version_probe.enabled=false;
+    return false;
+  }
+  if(JsonUtils::IsNull(members.front().second)) return false; // no such plot yet
+  try {
+    version = std::stoi(std::string(JsonUtils::Trim(members.front().second)));
+  } catch(const std::exception&){
+    m_plot_version_probe.enabled=false;
+    return false;
+  }
+  
+  return version>=0;
+  
+}
 
-  return m_services->GetPlotlyPlot(name, trace, layout, version, timeout);
+PlotCache* DAQInterface::GetPlotCache(){
+  
+  return m_plot_cache;
   
 }
 
 bool DAQInterface::SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout){
   
+  SpanTracer::Scope span(m_span_tracer, "SQLQuery");
   
-  return m_services->SQLQuery(query, responses, timeout);
+  return m_backend->SQLQuery(query, responses, timeout);
   
 }
 
 bool DAQInterface::SQLQuery(const std::string& query, std::string& response, const unsigned int timeout){
   
+  SpanTracer::Scope span(m_span_tracer, "SQLQuery");
   
-  return m_services->SQLQuery(query, response, timeout);
+  return m_backend->SQLQuery(query, response, timeout);
 }
 
 bool DAQInterface::SQLQuery(const std::string& query, const unsigned int timeout){
   
-  return m_services->SQLQuery(query, timeout);
+  SpanTracer::Scope span(m_span_tracer, "SQLQuery");
+  return m_backend->SQLQuery(query, timeout);
+  
+}
+
+bool DAQInterface::SQLQuery(const std::string& query, SQLResultSet& result, const unsigned int timeout){
+  
+  SpanTracer::Scope span(m_span_tracer, "SQLQuery");
+  std::string response;
+  if(!m_backend->SQLQuery(SQLResultSet::WrapQuery(query), response, timeout)){
+    result.Clear();
+    result.SetError(response);
+    return false;
+  }
+  
+  return result.Decode(response);
+  
+}
+
+bool DAQInterface::SQLBulkInsert(const std::string& table, const std::vector<std::string>& columns, const std::vector<SQLRow>& rows, std::vector<std::string>* batch_errors, const unsigned int batch_size, const unsigned int timeout){
+  
+  SpanTracer::Scope span(m_span_tracer, "SQLBulkInsert");
+  if(batch_errors) batch_errors->clear();
+  
+  std::vector<std::string> statements;
+  std::string error;
+  if(!SQLInsertBuilder::BuildStatements(table, columns, rows, statements, error, batch_size)){
+    if(batch_errors) batch_errors->push_back(error);
+    if(m_verbose) std::cerr<<"SQLBulkInsert: "<<error<<std::endl;
+    return false;
+  }
+  
+  // later batches are still attempted if one fails, so the caller can retry just the failed ones
+  bool ok=true;
+  std::string response;
+  for(size_t i=0; i<statements.size(); ++i){
+    response.clear();
+    bool batch_ok = m_backend->SQLQuery(statements[i], response, timeout);
+    if(!batch_ok && response.empty()) response = "batch "+std::to_string(i)+" failed";
+    if(batch_errors) batch_errors->push_back(batch_ok ? "" : response);
+    if(!batch_ok && m_verbose) std::cerr<<"SQLBulkInsert: batch "<<i<<" failed: "<<response<<std::endl;
+    ok = ok && batch_ok;
+  }
+  
+  return ok;
+  
+}
+
+// ===========================================================================
+// Pipelined Read Functions
+// ------------------------
+
+std::future<bool> DAQInterface::SQLQueryAsync(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout){
+  
+  return m_pipeline->Submit([this, query, &responses](const unsigned int remaining){ return m_backend->SQLQuery(query, responses, remaining); }, timeout);
+  
+}
+
+std::future<bool> DAQInterface::SQLQueryAsync(const std::string& query, std::string& response, const unsigned int timeout){
+  
+  return m_pipeline->Submit([this, query, &response](const unsigned int remaining){ return m_backend->SQLQuery(query, response, remaining); }, timeout);
+  
+}
+
+std::future<bool> DAQInterface::GetCalibrationDataAsync(std::string& json_data, int& version, const std::string& device, const unsigned int timeout){
+  
+  return m_pipeline->Submit([this, &json_data, &version, device](const unsigned int remaining){ return m_backend->GetCalibrationData(json_data, version, device, remaining); }, timeout);
+  
+}
+
+std::future<bool> DAQInterface::GetDeviceConfigAsync(std::string& json_data, const int version, const std::string& device, const unsigned int timeout){
+  
+  return m_pipeline->Submit([this, &json_data, version, device](const unsigned int remaining){ return m_backend->GetDeviceConfig(json_data, version, device, remaining); }, timeout);
+  
+}
+
+std::future<bool> DAQInterface::GetRunConfigAsync(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout){
+  
+  return m_pipeline->Submit([this, &json_data, base_config_id, runmode_config_id](const unsigned int remaining){ return GetRunConfig(json_data, base_config_id, runmode_config_id, remaining); }, timeout);
+  
+}
+
+std::future<bool> DAQInterface::GetDeviceConfigFromRunConfigAsync(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, const unsigned int timeout){
+  
+  return m_pipeline->Submit([this, &json_data, base_config_id, runmode_config_id, device](const unsigned int remaining){ return GetDeviceConfigFromRunConfig(json_data, base_config_id, runmode_config_id, device, remaining); }, timeout);
+  
+}
+
+std::future<bool> DAQInterface::SendCalibrationDataAsync(std::string json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
+  
+  return m_pipeline->Submit([this, json_data=std::move(json_data), description, device, timestamp, version](const unsigned int remaining){ return SendCalibrationData(json_data, description, device, timestamp, version, remaining); }, timeout);
+  
+}
+
+std::future<bool> DAQInterface::SendDeviceConfigAsync(std::string json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
+  
+  return m_pipeline->Submit([this, json_data=std::move(json_data), author, description, device, timestamp, version](const unsigned int remaining){ return SendDeviceConfig(json_data, author, description, device, timestamp, version, remaining); }, timeout);
+  
+}
+
+std::future<bool> DAQInterface::SendROOTplotAsync(const std::string& plot_name, const std::string& draw_options, std::string json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  return m_pipeline->Submit([this, plot_name, draw_options, json_data=std::move(json_data), version, timestamp, lifetime](const unsigned int remaining){ return SendROOTplot(plot_name, draw_options, json_data, version, timestamp, lifetime, remaining); }, timeout);
+  
+}
+
+std::future<bool> DAQInterface::SendPlotlyPlotAsync(const std::string& name, std::string json_trace, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  return m_pipeline->Submit([this, name, json_trace=std::move(json_trace), json_layout, version, timestamp, lifetime](const unsigned int remaining){ return SendPlotlyPlot(name, json_trace, json_layout, version, timestamp, lifetime, remaining); }, timeout);
+  
+}
+
+std::future<bool> DAQInterface::SendPlotlyPlotAsync(const std::string& name, std::vector<std::string> json_traces, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  return m_pipeline->Submit([this, name, json_traces=std::move(json_traces), json_layout, version, timestamp, lifetime](const unsigned int remaining){ return SendPlotlyPlot(name, json_traces, json_layout, version, timestamp, lifetime, remaining); }, timeout);
+  
+}
+
+RequestPipeline* DAQInterface::GetRequestPipeline(){
+  
+  return m_pipeline;
+  
+}
+
+MulticastSender* DAQInterface::GetMulticastSender(){
+  
+  return m_multicast;
+  
+}
+
+SpanTracer* DAQInterface::GetSpanTracer(){
+  
+  return m_span_tracer;
   
 }
 
@@ -160,29 +932,142 @@ bool DAQInterface::SQLQuery(const std::string& query, const unsigned int timeout
 // -----------------
 
 bool DAQInterface::SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp){
-    
-  return m_services->SendLog(message, severity, device, timestamp);
+  
+  SpanTracer::Scope span(m_span_tracer, "SendLog");
+  if(m_reliable_logger && static_cast<int>(severity)<=m_reliable_log_severity) return m_reliable_logger->SendLog(message, severity, device, timestamp);
+  
+  return m_multicast->SendLog(message, severity, device, timestamp);
+  
+}
+
+bool DAQInterface::SendLog(std::string&& message, LogLevel severity, const std::string& device, const uint64_t timestamp){
+  
+  SpanTracer::Scope span(m_span_tracer, "SendLog");
+  if(m_reliable_logger && static_cast<int>(severity)<=m_reliable_log_severity) return m_reliable_logger->SendLog(std::move(message), severity, device, timestamp);
+  
+  return m_multicast->SendLog(std::move(message), severity, device, timestamp);
+  
+}
+
+bool DAQInterface::SendLogReliable(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp){
+  
+  SpanTracer::Scope span(m_span_tracer, "SendLogReliable");
+  if(!m_reliable_logger){
+    if(m_verbose) std::cerr<<"SendLogReliable: reliable_logging is not enabled in the configuration"<<std::endl;
+    return false;
+  }
+  
+  return m_reliable_logger->SendLog(message, severity, device, timestamp);
+  
+}
+
+UploadDeduplicator* DAQInterface::GetUploadDeduplicator(){
+  
+  return m_dedup;
+  
+}
+
+ReliableLogger* DAQInterface::GetReliableLogger(){
+  
+  return m_reliable_logger;
   
 }
 
 bool DAQInterface::SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp){
   
-  return m_services->SendMonitoringData(json_data, subject, device, timestamp);
+  SpanTracer::Scope span(m_span_tracer, "SendMonitoringData");
+  return m_multicast->SendMonitoringData(json_data, subject, device, timestamp);
+  
+}
+
+bool DAQInterface::SendMonitoringData(std::string&& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp){
+  
+  SpanTracer::Scope span(m_span_tracer, "SendMonitoringData");
+  return m_multicast->SendMonitoringData(std::move(json_data), subject, device, timestamp);
+  
+}
+
+bool DAQInterface::RecordMonitoringValue(const std::string& subject, const std::string& field, const double value){
+  
+  return m_aggregator->Record(subject, field, value);
+  
+}
+
+MonitoringAggregator* DAQInterface::GetMonitoringAggregator(){
+  
+  return m_aggregator;
+  
+}
+
+uint32_t DAQInterface::RegisterMonitoringSchema(const std::string& subject, const std::vector<std::pair<std::string, SchemaFieldType> >& fields){
+  
+  return m_monitoring_schema->Register(subject, fields);
+  
+}
+
+bool DAQInterface::SendMonitoringValues(const uint32_t schema_id, const std::vector<double>& values){
+  
+  SpanTracer::Scope span(m_span_tracer, "SendMonitoringValues");
+  return m_monitoring_schema->Send(schema_id, values);
+  
+}
+
+MonitoringSchema* DAQInterface::GetMonitoringSchema(){
+  
+  return m_monitoring_schema;
   
 }
 
 bool DAQInterface::SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
   
-  return m_services->SendROOTplot(plot_name, draw_options, json_data, version, timestamp, lifetime, timeout);
+  SpanTracer::Scope span(m_span_tracer, "SendROOTplot");
+  std::string key = "root_plot:"+plot_name;
+  uint64_t hash = m_dedup ? UploadDeduplicator::Hash({draw_options, json_data, std::to_string(timestamp)+":"+std::to_string(lifetime)}) : 0;
+  if(m_dedup && m_dedup->IsDuplicate(key, hash, json_data.size(), version)) return true;
+  
+  if(!m_backend->SendROOTplot(plot_name, draw_options, json_data, version, timestamp, lifetime, timeout)) return false;
+  if(m_dedup) m_dedup->Sent(key, hash, version ? *version : -1);
+  
+  return true;
   
 }
 
 bool DAQInterface::SendPlotlyPlot(const std::string& name, const std::string& trace, const std::string& layout, int* version, const uint64_t timestamp, const unsigned int lifetime, unsigned int timeout) {
-  return m_services->SendPlotlyPlot(name, trace, layout, version, timestamp, lifetime, timeout);
+  
+  SpanTracer::Scope span(m_span_tracer, "SendPlotlyPlot");
+  std::string key = "plotly_plot:"+name;
+  uint64_t hash = m_dedup ? UploadDeduplicator::Hash({trace, layout, std::to_string(timestamp)+":"+std::to_string(lifetime)}) : 0;
+  if(m_dedup && m_dedup->IsDuplicate(key, hash, trace.size()+layout.size(), version)) return true;
+  
+  if(!m_backend->SendPlotlyPlot(name, trace, layout, version, timestamp, lifetime, timeout)) return false;
+  if(m_dedup) m_dedup->Sent(key, hash, version ? *version : -1);
+  
+  return true;
+  
 }
 
 bool DAQInterface::SendPlotlyPlot(const std::string& name, const std::vector<std::string>& traces, const std::string& layout, int* version, const uint64_t timestamp, const unsigned int lifetime, unsigned int timeout) {
-  return m_services->SendPlotlyPlot(name, traces, layout, version, timestamp, lifetime, timeout);
+  
+  SpanTracer::Scope span(m_span_tracer, "SendPlotlyPlot");
+  // same key as the single trace overload; the trace count is hashed so [a] and a differ
+  std::string key = "plotly_plot:"+name;
+  uint64_t hash=0;
+  size_t bytes=layout.size();
+  if(m_dedup){
+    std::string count = std::to_string(traces.size());
+    hash = UploadDeduplicator::Hash({count, layout, std::to_string(timestamp)+":"+std::to_string(lifetime)});
+    for(const std::string& trace : traces){
+      hash ^= UploadDeduplicator::Hash({trace}) + 0x9e3779b97f4a7c15ULL + (hash<<6) + (hash>>2);
+      bytes+=trace.size();
+    }
+    if(m_dedup->IsDuplicate(key, hash, bytes, version)) return true;
+  }
+  
+  if(!m_backend->SendPlotlyPlot(name, traces, layout, version, timestamp, lifetime, timeout)) return false;
+  if(m_dedup) m_dedup->Sent(key, hash, version ? *version : -1);
+  
+  return true;
+  
 }
 
 // ===========================================================================
@@ -197,28 +1082,186 @@ SlowControlCollection* DAQInterface::GetSlowControlCollection(){
 
 SlowControlElement* DAQInterface::GetSlowControlVariable(std::string key){
   
+  std::lock_guard<std::recursive_mutex> lock(m_sc_mtx);
   return sc_vars[key];
   
 }
 
+bool DAQInterface::WithSlowControlVariable(const std::string& name, const std::function<void(SlowControlElement&)>& function){
+  
+  std::lock_guard<std::recursive_mutex> lock(m_sc_mtx);
+  SlowControlElement* element = sc_vars[name];
+  if(!element) return false;
+  function(*element);
+  
+  return true;
+  
+}
+
 bool DAQInterface::AddSlowControlVariable(std::string name, SlowControlElementType type, std::function<std::string(const char*)> change_function, std::function<std::string(const char*)> read_function){
   
+  if(m_local_agent){
+    std::cerr<<"AddSlowControlVariable: '"<<name<<"' not added, slow controls are not served through the local agent"<<std::endl;
+    return false;
+  }
+  
+  std::lock_guard<std::recursive_mutex> lock(m_sc_mtx);
   return sc_vars.Add(name, type, change_function, read_function);
   
 }
 
+bool DAQInterface::AddSlowControlVariables(const std::string& json_spec, const std::map<std::string, std::function<std::string(const char*)> >& callbacks){
+  
+  if(m_local_agent){
+    std::cerr<<"AddSlowControlVariables: not added, slow controls are not served through the local agent"<<std::endl;
+    return false;
+  }
+  
+  std::vector<std::pair<std::string, std::string_view> > controls;
+  if(!JsonUtils::SplitObject(json_spec, controls)){
+    if(m_verbose) std::cerr<<"AddSlowControlVariables: malformed spec"<<std::endl;
+    return false;
+  }
+  
+  // parse and validate everything before touching sc_vars
+  std::vector<SlowControlSpec> specs(controls.size());
+  std::vector<std::pair<std::string, std::string_view> > fields;
+  
+  for(size_t i=0; i<controls.size(); ++i){
+    
+    SlowControlSpec& spec = specs[i];
+    spec.name = controls[i].first;
+    if(!JsonUtils::SplitObject(controls[i].second, fields)){
+      if(m_verbose) std::cerr<<"AddSlowControlVariables: malformed entry for '"<<spec.name<<"'"<<std::endl;
+      return false;
+    }
+    
+    bool has_type=false;
+    for(const std::pair<std::string, std::string_view>& field : fields){
+      
+      std::string value = JsonUtils::Unquote(field.second);
+      
+      if(field.first=="type"){
+        has_type = ParseSlowControlType(value, spec.type);
+        if(!has_type){
+          if(m_verbose) std::cerr<<"AddSlowControlVariables: unknown type '"<<value<<"' for '"<<spec.name<<"'"<<std::endl;
+          return false;
+        }
+      }
+      else if(field.first=="min" || field.first=="max" || field.first=="step"){
+        if(!ParseNumber(value, spec.limits[field.first])){
+          if(m_verbose) std::cerr<<"AddSlowControlVariables: non-numeric "<<field.first<<" for '"<<spec.name<<"'"<<std::endl;
+          return false;
+        }
+      }
+      else if(field.first=="value"){
+        spec.value = value;
+        spec.has_value = true;
+      }
+      else if(field.first=="options"){
+        std::vector<std::string_view> options;
+        if(!JsonUtils::SplitArray(field.second, options)){
+          if(m_verbose) std::cerr<<"AddSlowControlVariables: options for '"<<spec.name<<"' is not an array"<<std::endl;
+          return false;
+        }
+        for(std::string_view option : options) spec.options.push_back(JsonUtils::Unquote(option));
+      }
+      else if(field.first=="callback" || field.first=="read_callback"){
+        std::map<std::string, std::function<std::string(const char*)> >::const_iterator it = callbacks.find(value);
+        if(it==callbacks.end()){
+          if(m_verbose) std::cerr<<"AddSlowControlVariables: no callback named '"<<value<<"' for '"<<spec.name<<"'"<<std::endl;
+          return false;
+        }
+        if(field.first=="callback") spec.change_function = it->second;
+        else spec.read_function = it->second;
+      }
+      
+    }
+    
+    if(!has_type){
+      if(m_verbose) std::cerr<<"AddSlowControlVariables: no type given for '"<<spec.name<<"'"<<std::endl;
+      return false;
+    }
+    
+    double number=0;
+    if(spec.has_value && spec.type==VARIABLE && !ParseNumber(spec.value, number)){
+      if(m_verbose) std::cerr<<"AddSlowControlVariables: non-numeric value for '"<<spec.name<<"'"<<std::endl;
+      return false;
+    }
+    if(spec.has_value && spec.type==BUTTON && spec.value!="true" && spec.value!="false" && spec.value!="1" && spec.value!="0"){
+      if(m_verbose) std::cerr<<"AddSlowControlVariables: non-boolean value for '"<<spec.name<<"'"<<std::endl;
+      return false;
+    }
+    
+  }
+  
+  // apply, fully configuring each control as it's added
+  std::lock_guard<std::recursive_mutex> lock(m_sc_mtx);
+  std::vector<std::string> added;
+  added.reserve(specs.size());
+  
+  for(SlowControlSpec& spec : specs){
+    
+    if(!sc_vars.Add(spec.name, spec.type, spec.change_function, spec.read_function)){
+      if(m_verbose) std::cerr<<"AddSlowControlVariables: failed to add '"<<spec.name<<"', rolling back"<<std::endl;
+      for(const std::string& name : added) sc_vars.Remove(name);
+      return false;
+    }
+    added.push_back(spec.name);
+    
+    SlowControlElement* element = sc_vars[spec.name];
+    if(spec.limits.count("min")) element->SetMin(spec.limits["min"]);
+    if(spec.limits.count("max")) element->SetMax(spec.limits["max"]);
+    if(spec.limits.count("step")) element->SetStep(spec.limits["step"]);
+    for(const std::string& option : spec.options) element->AddOption(option);
+    
+    if(!spec.has_value) continue;
+    if(spec.type==VARIABLE) element->SetValue(std::strtod(spec.value.c_str(), nullptr));
+    else if(spec.type==BUTTON) element->SetValue(spec.value=="true" || spec.value=="1");
+    else element->SetValue(spec.value);
+    
+  }
+  
+  return true;
+  
+}
+
+bool DAQInterface::AddSlowControlVariables(Store& spec, const std::map<std::string, std::function<std::string(const char*)> >& callbacks){
+  
+  std::string json_spec;
+  spec>>json_spec;
+  
+  return AddSlowControlVariables(json_spec, callbacks);
+  
+}
+
 bool DAQInterface::RemoveSlowControlVariable(std::string name){
   
+  m_sc_history->Disable(name);
+  std::lock_guard<std::recursive_mutex> lock(m_sc_mtx);
   return sc_vars.Remove(name);
   
 }
 
 void DAQInterface::ClearSlowControlVariables(){
 
+  std::lock_guard<std::recursive_mutex> lock(m_sc_mtx);
   sc_vars.Clear();
 
 }
 
+bool DAQInterface::EnableSlowControlHistory(const std::string& name, const size_t samples){
+  
+  return m_sc_history->Enable(name, samples);
+  
+}
+
+SlowControlHistory* DAQInterface::GetSlowControlHistory(){
+  
+  return m_sc_history;
+  
+}
+
 bool DAQInterface::AlertSubscribe(std::string alert, std::function<void(const char*, const char*)> function){
   
   return sc_vars.AlertSubscribe(alert, function);
@@ -236,6 +1279,24 @@ std::string DAQInterface::PrintSlowControlVariables(){
   
 }
 
+bool DAQInterface::GetSlowControlChanges(std::string& json_data, const uint64_t since_version){
+  
+  SpanTracer::Scope span(m_span_tracer, "GetSlowControlChanges");
+  std::string snapshot;
+  {
+    std::lock_guard<std::recursive_mutex> lock(m_sc_mtx);
+    snapshot = sc_vars.Print();
+  }
+  if(!m_sc_changelog.Update(snapshot)){
+    if(m_verbose) std::cerr<<"GetSlowControlChanges: could not parse slow control collection"<<std::endl;
+    return false;
+  }
+  json_data = m_sc_changelog.Changes(since_version);
+  
+  return true;
+  
+}
+
 std::string DAQInterface::GetDeviceName(){
   
   return m_name;
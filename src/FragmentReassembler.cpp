@@ -0,0 +1,185 @@
+#include <FragmentReassembler.h>
+#include <JsonUtils.h>
+#include <cstdlib>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  size_t EscapedSize(const char c){
+    
+    switch(c){
+    case '"': case '\\': case '\n': case '\t': case '\r': case '\b': case '\f': return 2;
+    default: return (static_cast<unsigned char>(c)<0x20) ? 6 : 1;
+    }
+    
+  }
+  
+  // each fragment is itself embedded as a JSON string by SendLog/SendMonitoringData, so is escaped twice on the wire
+  size_t WireSize(const char c){
+    
+    switch(c){
+    case '"': case '\\': return 4;
+    case '\n': case '\t': case '\r': case '\b': case '\f': return 3;
+    default: return (static_cast<unsigned char>(c)<0x20) ? 7 : 1;
+    }
+    
+  }
+  
+  size_t WireSize(std::string_view text){
+    
+    size_t size=0;
+    for(const char c : text) size += EscapedSize(c);
+    
+    return size;
+    
+  }
+  
+  bool Continuation(const char c){
+    
+    return (static_cast<unsigned char>(c)&0xC0)==0x80;
+    
+  }
+  
+}
+
+FragmentReassembler::FragmentReassembler(const size_t max_bytes, const unsigned int timeout_ms) : m_max_bytes(max_bytes), m_timeout(timeout_ms), m_bytes(0), m_reassembled(0), m_expired(0){}
+
+bool FragmentReassembler::Split(const std::string& payload, const size_t max_bytes, const uint64_t id, std::vector<std::string>& fragments){
+  
+  fragments.clear();
+  if(max_bytes==0 || payload.size()<=max_bytes) return false;
+  
+  char hex_id[17];
+  snprintf(hex_id, sizeof(hex_id), "%016llx", static_cast<unsigned long long>(id));
+  
+  // room left for data once the header is written and escaped for embedding, allowing for a 5 digit index and count
+  const size_t header = WireSize(JsonUtils::Writer().AddString("fragment", hex_id).AddNumber("index", 99999).AddNumber("count", 99999).AddString("data", "").str()) + 2;
+  const size_t budget = (max_bytes>header+8) ? max_bytes-header : 8;
+  
+  std::vector<std::pair<size_t, size_t> > ranges;
+  size_t start=0;
+  while(start<payload.size()){
+    size_t end=start;
+    size_t escaped=0;
+    while(end<payload.size() && escaped+WireSize(payload[end])<=budget) escaped += WireSize(payload[end++]);
+    while(end<payload.size() && end>start+1 && Continuation(payload[end])) --end; // don't split a character
+    ranges.emplace_back(start, end-start);
+    start=end;
+  }
+  
+  for(size_t i=0; i<ranges.size(); ++i){
+    std::string_view part(payload.data()+ranges[i].first, ranges[i].second);
+    fragments.push_back(JsonUtils::Writer().AddString("fragment", hex_id).AddNumber("index", i).AddNumber("count", ranges.size()).AddString("data", part).str());
+  }
+  
+  return true;
+  
+}
+
+bool FragmentReassembler::IsFragment(const std::string& message){
+  
+  return message.compare(0, 13, "{\"fragment\":\"")==0;
+  
+}
+
+bool FragmentReassembler::Add(const std::string& source, const std::string& message, std::string& payload){
+  
+  if(!IsFragment(message)){
+    payload = message;
+    return true;
+  }
+  
+  std::vector<std::pair<std::string, std::string_view> > members;
+  if(!JsonUtils::SplitObject(message, members)) return false;
+  
+  std::string id;
+  long index=-1;
+  long count=0;
+  std::string data;
+  for(const std::pair<std::string, std::string_view>& member : members){
+    if(member.first=="fragment") id = JsonUtils::Unquote(member.second);
+    else if(member.first=="index") index = std::atol(std::string(member.second).c_str());
+    else if(member.first=="count") count = std::atol(std::string(member.second).c_str());
+    else if(member.first=="data") data = JsonUtils::Unquote(member.second);
+  }
+  if(id.empty() || count<=0 || index<0 || index>=count || count>100000) return false;
+  
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(m_mtx);
+  Expire(now);
+  
+  std::pair<std::string, std::string> key(source, id);
+  Partial& partial = m_partials[key];
+  if(partial.parts.empty()){
+    partial.parts.resize(count);
+    partial.started = now;
+  }
+  if(partial.parts.size()!=static_cast<size_t>(count) || !partial.parts[index].empty()) return false; // inconsistent or a repeat
+  
+  partial.bytes += data.size();
+  m_bytes += data.size();
+  partial.parts[index] = std::move(data);
+  ++partial.received;
+  
+  if(partial.received<partial.parts.size()){
+    Expire(now); // enforces the byte bound now this part is counted
+    return false;
+  }
+  
+  payload.clear();
+  payload.reserve(partial.bytes);
+  for(const std::string& part : partial.parts) payload += part;
+  m_bytes -= partial.bytes;
+  m_partials.erase(key);
+  ++m_reassembled;
+  
+  return true;
+  
+}
+
+void FragmentReassembler::Expire(const std::chrono::steady_clock::time_point now){
+  
+  // drop timed out partials, then the oldest until we're back under the byte bound
+  for(std::map<std::pair<std::string, std::string>, Partial>::iterator it=m_partials.begin(); it!=m_partials.end();){
+    if(now - it->second.started < m_timeout){
+      ++it;
+      continue;
+    }
+    m_bytes -= it->second.bytes;
+    it = m_partials.erase(it);
+    ++m_expired;
+  }
+  
+  while(m_bytes>m_max_bytes && !m_partials.empty()){
+    std::map<std::pair<std::string, std::string>, Partial>::iterator oldest = m_partials.begin();
+    for(std::map<std::pair<std::string, std::string>, Partial>::iterator it=m_partials.begin(); it!=m_partials.end(); ++it){
+      if(it->second.started < oldest->second.started) oldest = it;
+    }
+    m_bytes -= oldest->second.bytes;
+    m_partials.erase(oldest);
+    ++m_expired;
+  }
+  
+}
+
+unsigned long FragmentReassembler::Reassembled(){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_reassembled;
+  
+}
+
+unsigned long FragmentReassembler::Expired(){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_expired;
+  
+}
+
+size_t FragmentReassembler::Pending(){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_partials.size();
+  
+}
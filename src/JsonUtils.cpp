@@ -0,0 +1,308 @@
+#include <JsonUtils.h>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  bool IsSpace(char c){
+    return c==' ' || c=='\t' || c=='\n' || c=='\r';
+  }
+  
+  // length of Quote(value), quotes included
+  size_t QuotedSize(std::string_view value){
+    size_t length=2;
+    for(char c : value){
+      if(c=='"' || c=='\\' || c=='\n' || c=='\t' || c=='\r' || c=='\b' || c=='\f') length+=2;
+      else if(static_cast<unsigned char>(c)<0x20) length+=6;
+      else ++length;
+    }
+    return length;
+  }
+  
+  // advance pos past the JSON value starting at pos. returns false on malformed input.
+  bool SkipValue(std::string_view json, size_t& pos){
+    
+    if(pos>=json.size()) return false;
+    
+    if(json[pos]=='"'){
+      for(++pos; pos<json.size(); ++pos){
+        if(json[pos]=='\\') ++pos;
+        else if(json[pos]=='"'){ ++pos; return true; }
+      }
+      return false;
+    }
+    
+    if(json[pos]=='{' || json[pos]=='['){
+      int depth=0;
+      bool in_string=false;
+      for(; pos<json.size(); ++pos){
+        char c=json[pos];
+        if(in_string){
+          if(c=='\\') ++pos;
+          else if(c=='"') in_string=false;
+        }
+        else if(c=='"') in_string=true;
+        else if(c=='{' || c=='[') ++depth;
+        else if(c=='}' || c==']'){
+          if(--depth==0){ ++pos; return true; }
+        }
+      }
+      return false;
+    }
+    
+    // number, true, false, null
+    size_t start=pos;
+    while(pos<json.size() && json[pos]!=',' && json[pos]!='}' && json[pos]!=']' && !IsSpace(json[pos])) ++pos;
+    return pos>start;
+    
+  }
+  
+  void SkipSpace(std::string_view json, size_t& pos){
+    while(pos<json.size() && IsSpace(json[pos])) ++pos;
+  }
+  
+}
+
+std::string_view JsonUtils::Trim(std::string_view value){
+  
+  while(!value.empty() && IsSpace(value.front())) value.remove_prefix(1);
+  while(!value.empty() && IsSpace(value.back())) value.remove_suffix(1);
+  return value;
+  
+}
+
+bool JsonUtils::IsString(std::string_view value){
+  
+  value=Trim(value);
+  return value.size()>=2 && value.front()=='"' && value.back()=='"';
+  
+}
+
+bool JsonUtils::IsNull(std::string_view value){
+  
+  return Trim(value)=="null";
+  
+}
+
+bool JsonUtils::SplitObject(std::string_view json, std::vector<std::pair<std::string, std::string_view> >& members){
+  
+  members.clear();
+  size_t pos=0;
+  SkipSpace(json, pos);
+  if(pos>=json.size() || json[pos]!='{') return false;
+  ++pos;
+  SkipSpace(json, pos);
+  if(pos<json.size() && json[pos]=='}') return true;
+  
+  while(pos<json.size()){
+    
+    SkipSpace(json, pos);
+    size_t key_start=pos;
+    if(pos>=json.size() || json[pos]!='"' || !SkipValue(json, pos)) return false;
+    std::string key=Unquote(json.substr(key_start, pos-key_start));
+    
+    SkipSpace(json, pos);
+    if(pos>=json.size() || json[pos]!=':') return false;
+    ++pos;
+    SkipSpace(json, pos);
+    
+    size_t value_start=pos;
+    if(!SkipValue(json, pos)) return false;
+    members.emplace_back(std::move(key), json.substr(value_start, pos-value_start));
+    
+    SkipSpace(json, pos);
+    if(pos>=json.size()) return false;
+    if(json[pos]=='}') return true;
+    if(json[pos]!=',') return false;
+    ++pos;
+    
+  }
+  
+  return false;
+  
+}
+
+bool JsonUtils::SplitArray(std::string_view json, std::vector<std::string_view>& elements){
+  
+  elements.clear();
+  size_t pos=0;
+  SkipSpace(json, pos);
+  if(pos>=json.size() || json[pos]!='[') return false;
+  ++pos;
+  SkipSpace(json, pos);
+  if(pos<json.size() && json[pos]==']') return true;
+  
+  while(pos<json.size()){
+    
+    SkipSpace(json, pos);
+    size_t value_start=pos;
+    if(!SkipValue(json, pos)) return false;
+    elements.push_back(json.substr(value_start, pos-value_start));
+    
+    SkipSpace(json, pos);
+    if(pos>=json.size()) return false;
+    if(json[pos]==']') return true;
+    if(json[pos]!=',') return false;
+    ++pos;
+    
+  }
+  
+  return false;
+  
+}
+
+std::string JsonUtils::Unquote(std::string_view value){
+  
+  value=Trim(value);
+  if(!IsString(value)) return std::string{value};
+  
+  std::string out;
+  out.reserve(value.size()-2);
+  for(size_t i=1; i+1<value.size(); ++i){
+    char c=value[i];
+    if(c!='\\' || i+2>=value.size()){
+      out+=c;
+      continue;
+    }
+    c=value[++i];
+    switch(c){
+    case 'n': out+='\n'; break;
+    case 't': out+='\t'; break;
+    case 'r': out+='\r'; break;
+    case 'b': out+='\b'; break;
+    case 'f': out+='\f'; break;
+    case 'u': {
+      // only the basic multilingual plane is handled; encode as UTF-8
+      if(i+4>=value.size()) return out;
+      unsigned int code=std::strtoul(std::string{value.substr(i+1,4)}.c_str(), nullptr, 16);
+      i+=4;
+      if(code<0x80) out+=char(code);
+      else if(code<0x800){
+        out+=char(0xC0 | (code>>6));
+        out+=char(0x80 | (code & 0x3F));
+      } else {
+        out+=char(0xE0 | (code>>12));
+        out+=char(0x80 | ((code>>6) & 0x3F));
+        out+=char(0x80 | (code & 0x3F));
+      }
+      break;
+    }
+    default: out+=c; // covers \" \\ and \/
+    }
+  }
+  
+  return out;
+  
+}
+
+std::string JsonUtils::Quote(std::string_view value){
+  
+  std::string out;
+  AppendQuoted(out, value);
+  
+  return out;
+  
+}
+
+void JsonUtils::AppendQuoted(std::string& out, std::string_view value, const size_t slack){
+  
+  // size the escaped text first so a large value is written in place, never moved by a reallocation
+  size_t length = QuotedSize(value);
+  if(out.size()+length>out.capacity()) out.reserve(out.size()+length+slack);
+  
+  out+='"';
+  for(char c : value){
+    switch(c){
+    case '"': out+="\\\""; break;
+    case '\\': out+="\\\\"; break;
+    case '\n': out+="\\n"; break;
+    case '\t': out+="\\t"; break;
+    case '\r': out+="\\r"; break;
+    case '\b': out+="\\b"; break;
+    case '\f': out+="\\f"; break;
+    default:
+      if(static_cast<unsigned char>(c)<0x20){
+        char buf[8];
+        snprintf(buf, sizeof(buf), "\\u%04x", c);
+        out+=buf;
+      } else out+=c;
+    }
+  }
+  out+='"';
+  
+}
+
+void JsonUtils::Writer::Key(const std::string& key){
+  
+  m_json += m_json.empty() ? "{" : ",";
+  AppendQuoted(m_json, key);
+  m_json += ':';
+  
+}
+
+JsonUtils::Writer& JsonUtils::Writer::AddString(const std::string& key, std::string_view value){
+  
+  Key(key);
+  AppendQuoted(m_json, value, 1024); // room for the small fields that usually follow a payload
+  return *this;
+  
+}
+
+JsonUtils::Writer& JsonUtils::Writer::AddNumber(const std::string& key, const int64_t value){
+  
+  Key(key);
+  m_json += std::to_string(value);
+  return *this;
+  
+}
+
+JsonUtils::Writer& JsonUtils::Writer::AddBool(const std::string& key, const bool value){
+  
+  Key(key);
+  m_json += value ? "true" : "false";
+  return *this;
+  
+}
+
+JsonUtils::Writer& JsonUtils::Writer::AddStrings(const std::string& key, const std::vector<std::string>& values){
+  
+  Key(key);
+  size_t length=2;
+  for(const std::string& value : values) length += QuotedSize(value)+1;
+  if(m_json.size()+length>m_json.capacity()) m_json.reserve(m_json.size()+length+1024);
+  m_json += '[';
+  for(size_t i=0; i<values.size(); ++i){
+    if(i) m_json += ',';
+    AppendQuoted(m_json, values[i]);
+  }
+  m_json += ']';
+  return *this;
+  
+}
+
+JsonUtils::Writer& JsonUtils::Writer::AddRaw(const std::string& key, std::string_view json){
+  
+  Key(key);
+  m_json += json;
+  return *this;
+  
+}
+
+std::string JsonUtils::Writer::str() const{
+  
+  return m_json.empty() ? "{}" : m_json+"}";
+  
+}
+
+std::string JsonUtils::Writer::Take(){
+  
+  if(m_json.empty()) return "{}";
+  m_json += '}';
+  std::string json = std::move(m_json);
+  m_json.clear();
+  
+  return json;
+  
+}
@@ -0,0 +1,277 @@
+#include <LocalAgent.h>
+#include <JsonUtils.h>
+#include <map>
+#include <climits>
+#include <cstdlib>
+#include <chrono>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  bool Parse(const std::string& json, std::map<std::string, std::string>& fields){
+    
+    std::vector<std::pair<std::string, std::string_view> > members;
+    if(!JsonUtils::SplitObject(json, members)) return false;
+    for(const std::pair<std::string, std::string_view>& member : members){
+      fields[member.first] = JsonUtils::IsString(member.second) ? JsonUtils::Unquote(member.second) : std::string{member.second};
+    }
+    
+    return true;
+    
+  }
+  
+  long long GetNumber(std::map<std::string, std::string>& fields, const std::string& key, long long fallback=0){
+    
+    std::map<std::string, std::string>::iterator it = fields.find(key);
+    return (it==fields.end()) ? fallback : std::atoll(it->second.c_str());
+    
+  }
+  
+}
+
+LocalAgent::LocalAgent(DAQInterface* daq, const unsigned int workers) : m_daq(daq), m_pipeline(workers), m_running(false), m_messages(0), m_requests(0), m_priority_requests(0), m_expired(0), m_late_replies(0){}
+
+LocalAgent::~LocalAgent(){
+  
+  Stop();
+  
+}
+
+bool LocalAgent::Start(const std::string& ring_name, const uint32_t slots, const uint32_t slot_size, const uint32_t priority_slots){
+  
+  if(m_running) return false;
+  if(!m_ring.Create(ring_name, slots, slot_size)) return false;
+  if(!m_priority_ring.Create(ring_name+"_priority", priority_slots, slot_size)) return false;
+  
+  m_running=true;
+  m_thread = std::thread(&LocalAgent::Thread, this);
+  m_priority_thread = std::thread(&LocalAgent::PriorityThread, this);
+  
+  return true;
+  
+}
+
+void LocalAgent::Stop(){
+  
+  if(!m_running) return;
+  m_running=false;
+  m_thread.join();
+  m_priority_thread.join();
+  
+}
+
+void LocalAgent::Thread(){
+  
+  AgentMessageType type;
+  std::string payload;
+  SharedMemoryRing::Slot* request;
+  std::chrono::steady_clock::time_point next_reclaim = std::chrono::steady_clock::now();
+  
+  while(m_running){
+    
+    if(std::chrono::steady_clock::now()>=next_reclaim){
+      m_ring.Reclaim(); // slots left behind by clients that died
+      next_reclaim = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    }
+    
+    if(!m_ring.Receive(type, payload, request, 100)) continue;
+    
+    if(type==AgentMessageType::Request){
+      ++m_requests;
+      // the client enforces its own timeout, so never expire requests in the queue:
+      // the slot is only released once Reply has been called
+      m_pipeline.Submit([this, request, payload](const unsigned int){
+        std::string reply;
+        bool ok=false;
+        if(m_ring.Abandoned(request)) ++m_expired; // nobody to answer; just free the slot
+        else ok = Dispatch(payload, reply);
+        if(!m_ring.Reply(request, ok, reply) && ok) ++m_late_replies;
+        return ok;
+      }, UINT_MAX);
+      continue;
+    }
+    
+    ++m_messages;
+    std::map<std::string, std::string> fields;
+    if(!Parse(payload, fields)) continue;
+    
+    if(type==AgentMessageType::Log){
+      m_daq->SendLog(fields["message"], static_cast<LogLevel>(GetNumber(fields, "severity")), fields["device"], GetNumber(fields, "timestamp"));
+    }
+    else if(type==AgentMessageType::Monitoring){
+      m_daq->SendMonitoringData(fields["data"], fields["subject"], fields["device"], GetNumber(fields, "timestamp"));
+    }
+    
+  }
+  
+}
+
+void LocalAgent::PriorityThread(){
+  
+  AgentMessageType type;
+  std::string payload;
+  SharedMemoryRing::Slot* request;
+  std::chrono::steady_clock::time_point next_reclaim = std::chrono::steady_clock::now();
+  
+  // served inline: this lane only carries a trickle of urgent requests, and must not wait on the worker pool
+  while(m_running){
+    
+    if(std::chrono::steady_clock::now()>=next_reclaim){
+      m_priority_ring.Reclaim();
+      next_reclaim = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    }
+    
+    if(!m_priority_ring.Receive(type, payload, request, 100) || type!=AgentMessageType::Request) continue;
+    
+    ++m_priority_requests;
+    std::string reply;
+    bool ok = Dispatch(payload, reply);
+    if(!m_priority_ring.Reply(request, ok, reply) && ok) ++m_late_replies;
+    
+  }
+  
+}
+
+bool LocalAgent::Dispatch(const std::string& request, std::string& reply){
+  
+  std::map<std::string, std::string> fields;
+  if(!Parse(request, fields)){
+    reply = "malformed request";
+    return false;
+  }
+  
+  const std::string& call = fields["call"];
+  unsigned int timeout = GetNumber(fields, "timeout", default_timeout);
+  
+  // past the client's deadline nobody is waiting; before it, our own call gets only what's left
+  long long deadline = GetNumber(fields, "deadline");
+  if(deadline){
+    long long remaining = deadline - std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if(remaining<=0){
+      ++m_expired;
+      reply = "deadline passed before the agent served the request";
+      return false;
+    }
+    if(remaining<timeout) timeout = remaining;
+  }
+  JsonUtils::Writer out;
+  std::string data;
+  int version = GetNumber(fields, "version", -1);
+  bool ok=false;
+  
+  if(call=="SQLQuery"){
+    if(fields["multi"]=="true"){
+      std::vector<std::string> responses;
+      ok = m_daq->SQLQuery(fields["query"], responses, timeout);
+      if(!ok && !responses.empty()) data = responses.front();
+      out.AddStrings("responses", responses);
+    } else {
+      ok = m_daq->SQLQuery(fields["query"], data, timeout);
+      out.AddString("data", data);
+    }
+  }
+  else if(call=="SendAlarm"){
+    ok = m_daq->SendAlarm(fields["message"], fields["critical"]=="true", fields["device"], GetNumber(fields, "timestamp"), timeout);
+  }
+  else if(call=="SendCalibrationData"){
+    ok = m_daq->SendCalibrationData(fields["data"], fields["description"], fields["device"], GetNumber(fields, "timestamp"), &version, timeout);
+    out.AddNumber("version", version);
+  }
+  else if(call=="GetCalibrationData"){
+    ok = m_daq->GetCalibrationData(data, version, fields["device"], timeout);
+    out.AddString("data", data).AddNumber("version", version);
+  }
+  else if(call=="SendDeviceConfig"){
+    ok = m_daq->SendDeviceConfig(fields["data"], fields["author"], fields["description"], fields["device"], GetNumber(fields, "timestamp"), &version, timeout);
+    out.AddNumber("version", version);
+  }
+  else if(call=="GetDeviceConfig"){
+    ok = m_daq->GetDeviceConfig(data, version, fields["device"], timeout);
+    out.AddString("data", data);
+  }
+  else if(call=="GetRunConfig"){
+    ok = m_daq->GetRunConfig(data, GetNumber(fields, "base_config_id"), GetNumber(fields, "runmode_config_id"), timeout);
+    out.AddString("data", data);
+  }
+  else if(call=="GetRunModeConfig"){
+    ok = m_daq->GetRunModeConfig(data, fields["name"], version, timeout);
+    out.AddString("data", data);
+  }
+  else if(call=="GetDeviceConfigFromRunConfig"){
+    ok = m_daq->GetDeviceConfigFromRunConfig(data, GetNumber(fields, "base_config_id"), GetNumber(fields, "runmode_config_id"), fields["device"], timeout);
+    out.AddString("data", data);
+  }
+  else if(call=="SendROOTplot"){
+    ok = m_daq->SendROOTplot(fields["name"], fields["draw_options"], fields["data"], &version, GetNumber(fields, "timestamp"), GetNumber(fields, "lifetime", 5), timeout);
+    out.AddNumber("version", version);
+  }
+  else if(call=="GetROOTplot"){
+    std::string draw_options;
+    ok = m_daq->GetROOTplot(fields["name"], draw_options, data, version, timeout);
+    out.AddString("draw_options", draw_options).AddString("data", data).AddNumber("version", version);
+  }
+  else if(call=="SendPlotlyPlot"){
+    if(fields.count("traces")){
+      std::vector<std::string_view> elements;
+      std::vector<std::string> traces;
+      JsonUtils::SplitArray(fields["traces"], elements);
+      for(std::string_view trace : elements) traces.push_back(JsonUtils::Unquote(trace));
+      ok = m_daq->SendPlotlyPlot(fields["name"], traces, fields["layout"], &version, GetNumber(fields, "timestamp"), GetNumber(fields, "lifetime", 5), timeout);
+    } else {
+      ok = m_daq->SendPlotlyPlot(fields["name"], fields["trace"], fields["layout"], &version, GetNumber(fields, "timestamp"), GetNumber(fields, "lifetime", 5), timeout);
+    }
+    out.AddNumber("version", version);
+  }
+  else if(call=="GetPlotlyPlot"){
+    std::string layout;
+    ok = m_daq->GetPlotlyPlot(fields["name"], data, layout, version, timeout);
+    out.AddString("trace", data).AddString("layout", layout).AddNumber("version", version);
+  }
+  else {
+    reply = "unknown call '"+call+"'";
+    return false;
+  }
+  
+  // on failure the reply is the error text, as the services calls leave it in their output
+  reply = ok ? out.str() : data;
+  
+  return ok;
+  
+}
+
+unsigned long LocalAgent::Messages(){
+  
+  return m_messages;
+  
+}
+
+unsigned long LocalAgent::Requests(){
+  
+  return m_requests;
+  
+}
+
+unsigned long LocalAgent::PriorityRequests(){
+  
+  return m_priority_requests;
+  
+}
+
+unsigned long LocalAgent::Expired(){
+  
+  return m_expired;
+  
+}
+
+unsigned long LocalAgent::LateReplies(){
+  
+  return m_late_replies;
+  
+}
+
+unsigned long LocalAgent::Reclaimed(){
+  
+  return m_ring.Reclaimed() + m_priority_ring.Reclaimed();
+  
+}
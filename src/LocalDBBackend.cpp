@@ -0,0 +1,601 @@
+#include <LocalDBBackend.h>
+#include <JsonUtils.h>
+#include <sqlite3.h>
+#include <map>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  // same names and columns as the central database; version and time fill themselves in for plain SQL inserts
+  const char* schema =
+    "CREATE TABLE IF NOT EXISTS devices(name TEXT PRIMARY KEY);"
+    "CREATE TABLE IF NOT EXISTS logging(time TEXT, device TEXT, severity INTEGER, message TEXT);"
+    "CREATE TABLE IF NOT EXISTS monitoring(time TEXT, device TEXT, subject TEXT, data TEXT);"
+    "CREATE TABLE IF NOT EXISTS alarms(time TEXT, device TEXT, critical INTEGER, message TEXT);"
+    "CREATE TABLE IF NOT EXISTS calibration(time TEXT, device TEXT, version INTEGER, description TEXT, data TEXT);"
+    "CREATE TABLE IF NOT EXISTS device_config(time TEXT, device TEXT, version INTEGER, author TEXT, description TEXT, data TEXT);"
+    "CREATE TABLE IF NOT EXISTS base_config(config_id INTEGER PRIMARY KEY, time TEXT, name TEXT, version INTEGER, author TEXT, description TEXT, data TEXT);"
+    "CREATE TABLE IF NOT EXISTS runmode_config(config_id INTEGER PRIMARY KEY, time TEXT, name TEXT, version INTEGER, author TEXT, description TEXT, data TEXT);"
+    "CREATE TABLE IF NOT EXISTS rootplots(time TEXT, name TEXT, version INTEGER, draw_options TEXT, data TEXT, lifetime INTEGER);"
+    "CREATE TABLE IF NOT EXISTS plotlyplots(time TEXT, name TEXT, version INTEGER, data TEXT, layout TEXT, lifetime INTEGER);"
+    "CREATE TABLE IF NOT EXISTS outbox(id INTEGER PRIMARY KEY AUTOINCREMENT, method TEXT, args TEXT);";
+    
+  // versioned tables and the column versions are numbered by
+  const std::pair<const char*, const char*> versioned[]={{"calibration", "device"}, {"device_config", "device"}, {"base_config", "name"},
+                                                         {"runmode_config", "name"}, {"rootplots", "name"}, {"plotlyplots", "name"}};
+  
+  // how long a call waits on another process holding the file's write lock
+  const int busy_timeout_ms=1000;
+  
+  const char* now_sql = "strftime('%Y-%m-%dT%H:%M:%fZ','now')";
+  
+  uint64_t NowMs(){
+    
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    
+  }
+  
+  // ISO 8601 UTC with milliseconds, as ReliableLogger writes them
+  std::string FormatTime(uint64_t ms_since_epoch){
+    
+    std::time_t seconds = ms_since_epoch/1000;
+    std::tm utc;
+    gmtime_r(&seconds, &utc);
+    char buf[40];
+    size_t len = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &utc);
+    snprintf(buf+len, sizeof(buf)-len, ".%03uZ", static_cast<unsigned int>(ms_since_epoch%1000));
+    
+    return buf;
+    
+  }
+  
+  // interrupts whatever statement is still running at the deadline, as nobody will read its result
+  class DeadlineGuard{
+    
+  public:
+    
+    DeadlineGuard(sqlite3* db, const unsigned int timeout_ms) : m_db(timeout_ms ? db : nullptr), m_deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms)){
+      if(m_db) sqlite3_progress_handler(m_db, 1000, &DeadlineGuard::Passed, &m_deadline);
+    }
+    
+    ~DeadlineGuard(){
+      if(m_db) sqlite3_progress_handler(m_db, 0, nullptr, nullptr);
+    }
+    
+  private:
+    
+    static int Passed(void* deadline){
+      return std::chrono::steady_clock::now() > *static_cast<std::chrono::steady_clock::time_point*>(deadline);
+    }
+    
+    sqlite3* m_db;
+    std::chrono::steady_clock::time_point m_deadline;
+    
+  };
+  
+  std::string Text(sqlite3_stmt* stmt, int column){
+    
+    const unsigned char* text = sqlite3_column_text(stmt, column);
+    return text ? std::string(reinterpret_cast<const char*>(text), sqlite3_column_bytes(stmt, column)) : std::string();
+    
+  }
+  
+  // one result row as a JSON object keyed by column name, as the middleman returns them
+  std::string RowJson(sqlite3_stmt* stmt){
+    
+    JsonUtils::Writer row;
+    for(int i=0; i<sqlite3_column_count(stmt); i++){
+      const char* name = sqlite3_column_name(stmt, i);
+      switch(sqlite3_column_type(stmt, i)){
+      case SQLITE_INTEGER:
+        row.AddNumber(name, sqlite3_column_int64(stmt, i));
+        break;
+      case SQLITE_FLOAT:{
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.17g", sqlite3_column_double(stmt, i));
+        row.AddRaw(name, buf);
+        break;
+      }
+      case SQLITE_NULL:
+        row.AddRaw(name, "null");
+        break;
+      default:
+        row.AddString(name, Text(stmt, i));
+      }
+    }
+    
+    return row.str();
+    
+  }
+  
+}
+
+LocalDBBackend::LocalDBBackend(const std::string& device_name, DAQBackend* central, const unsigned int sync_period_s) : m_device_name(device_name), m_db(nullptr), m_central(central), m_sync_period_s(sync_period_s), m_synced(0), m_cancelled(0), m_running(false){}
+
+LocalDBBackend::~LocalDBBackend(){
+  
+  if(m_thread.joinable()){
+    {
+      std::lock_guard<std::mutex> lock(m_thread_mtx);
+      m_running=false;
+    }
+    m_thread_cv.notify_all();
+    m_thread.join();
+  }
+  
+  delete m_central;
+  m_central=nullptr;
+  
+  if(m_db) sqlite3_close(m_db);
+  m_db=nullptr;
+  
+}
+
+bool LocalDBBackend::Open(const std::string& file, std::string& error){
+  
+  std::lock_guard<std::mutex> lock(m_db_mtx);
+  
+  if(sqlite3_open_v2(file.c_str(), &m_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, nullptr)!=SQLITE_OK){
+    error = m_db ? sqlite3_errmsg(m_db) : "out of memory";
+    sqlite3_close(m_db);
+    m_db=nullptr;
+    return false;
+  }
+  
+  sqlite3_busy_timeout(m_db, busy_timeout_ms);
+  
+  // WAL with normal sync keeps a write to tens of microseconds and lets other processes read the file meanwhile
+  std::string ddl = std::string("PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;") + schema;
+  for(const std::pair<const char*, const char*>& table : versioned){
+    std::string name = table.first;
+    std::string key = table.second;
+    ddl += "CREATE UNIQUE INDEX IF NOT EXISTS "+name+"_version ON "+name+"("+key+", version);"
+           "CREATE TRIGGER IF NOT EXISTS "+name+"_defaults AFTER INSERT ON "+name+" BEGIN "
+           "UPDATE "+name+" SET version=COALESCE(NEW.version, (SELECT COALESCE(MAX(version)+1, 0) FROM "+name+" WHERE "+key+"=NEW."+key+")), "
+           "time=COALESCE(NEW.time, "+now_sql+") WHERE rowid=NEW.rowid AND (NEW.version IS NULL OR NEW.time IS NULL); END;";
+  }
+  
+  if(!Run(ddl, {}, error)){
+    sqlite3_close(m_db);
+    m_db=nullptr;
+    return false;
+  }
+  
+  if(m_central){
+    m_running=true;
+    m_thread = std::thread(&LocalDBBackend::SyncThread, this);
+  }
+  
+  return true;
+  
+}
+
+bool LocalDBBackend::Run(const std::string& sql, const std::vector<Value>& values, std::string& error, const std::function<void(sqlite3_stmt*)>& row, const unsigned int timeout){
+  
+  if(!m_db){
+    error = "local database is not open";
+    return false;
+  }
+  DeadlineGuard guard(m_db, timeout);
+  
+  // several statements run in turn; values bind to the first
+  const char* next = sql.c_str();
+  bool first=true;
+  while(*next){
+    sqlite3_stmt* stmt=nullptr;
+    if(sqlite3_prepare_v2(m_db, next, -1, &stmt, &next)!=SQLITE_OK){
+      error = sqlite3_errmsg(m_db);
+      return false;
+    }
+    if(!stmt) continue; // whitespace or a comment
+    
+    if(first){
+      for(size_t i=0; i<values.size(); i++){
+        if(std::holds_alternative<int64_t>(values[i])) sqlite3_bind_int64(stmt, i+1, std::get<int64_t>(values[i]));
+        else sqlite3_bind_text(stmt, i+1, std::get<std::string>(values[i]).c_str(), std::get<std::string>(values[i]).size(), SQLITE_STATIC);
+      }
+      first=false;
+    }
+    
+    int rc;
+    while((rc=sqlite3_step(stmt))==SQLITE_ROW){
+      if(row) row(stmt);
+    }
+    sqlite3_finalize(stmt);
+    if(rc==SQLITE_INTERRUPT){
+      ++m_cancelled;
+      error = "deadline passed while the query was running";
+      return false;
+    }
+    if(rc!=SQLITE_DONE){
+      error = sqlite3_errmsg(m_db);
+      return false;
+    }
+  }
+  
+  return true;
+  
+}
+
+bool LocalDBBackend::Insert(const std::string& table, const std::vector<std::string>& columns, const std::vector<Value>& values, const bool versioned, int* version, const std::string& outbox){
+  
+  std::string names;
+  std::string placeholders;
+  for(const std::string& column : columns){
+    names += (names.empty() ? "" : ", ") + column;
+    placeholders += placeholders.empty() ? "?" : ", ?";
+  }
+  
+  std::lock_guard<std::mutex> lock(m_db_mtx);
+  std::string error;
+  
+  // the row and its outbox entry go in together, or not at all
+  if(m_central && !Run("BEGIN", {}, error)) return false;
+  bool ok = Run("INSERT INTO "+table+" ("+names+") VALUES ("+placeholders+")", values, error);
+  if(ok && versioned && version){
+    ok = Run("SELECT version FROM "+table+" WHERE rowid=last_insert_rowid()", {}, error, [version](sqlite3_stmt* stmt){ *version = sqlite3_column_int(stmt, 0); });
+  }
+  if(m_central){
+    if(ok) ok = Run("INSERT INTO outbox (method, args) VALUES (?, ?)", {table, outbox}, error);
+    Run(ok ? "COMMIT" : "ROLLBACK", {}, error);
+  }
+  
+  return ok;
+  
+}
+
+bool LocalDBBackend::Select(const std::string& sql, const std::vector<Value>& values, std::vector<std::string>& columns, std::string& error){
+  
+  columns.clear();
+  bool found=false;
+  std::lock_guard<std::mutex> lock(m_db_mtx);
+  if(!Run(sql, values, error, [&columns, &found](sqlite3_stmt* stmt){
+        if(found) return;
+        found=true;
+        for(int i=0; i<sqlite3_column_count(stmt); i++) columns.push_back(Text(stmt, i));
+      })) return false;
+  if(!found) error = "no matching entry";
+  
+  return found;
+  
+}
+
+const std::string& LocalDBBackend::Device(const std::string& device){
+  
+  return device.empty() ? m_device_name : device;
+  
+}
+
+// ==================================================================================================
+// sync to the central database
+
+bool LocalDBBackend::Replay(const std::string& method, const std::string& args){
+  
+  std::vector<std::pair<std::string, std::string_view> > members;
+  if(!JsonUtils::SplitObject(args, members)) return true; // unreadable; retrying won't help
+  std::map<std::string, std::string> arg;
+  for(const std::pair<std::string, std::string_view>& member : members){
+    arg[member.first] = JsonUtils::IsString(member.second) ? JsonUtils::Unquote(member.second) : std::string{member.second};
+  }
+  
+  const unsigned int timeout=300;
+  uint64_t timestamp = std::strtoull(arg["timestamp"].c_str(), nullptr, 10);
+  unsigned int lifetime = std::atoi(arg["lifetime"].c_str());
+  
+  if(method=="logging") return m_central->SendLog(arg["message"], static_cast<LogLevel>(std::atoi(arg["severity"].c_str())), arg["device"], timestamp);
+  if(method=="monitoring") return m_central->SendMonitoringData(arg["data"], arg["subject"], arg["device"], timestamp);
+  if(method=="alarms") return m_central->SendAlarm(arg["message"], arg["critical"]=="1", arg["device"], timestamp, timeout);
+  if(method=="calibration") return m_central->SendCalibrationData(arg["data"], arg["description"], arg["device"], timestamp, nullptr, timeout);
+  if(method=="device_config") return m_central->SendDeviceConfig(arg["data"], arg["author"], arg["description"], arg["device"], timestamp, nullptr, timeout);
+  if(method=="rootplots") return m_central->SendROOTplot(arg["name"], arg["draw_options"], arg["data"], nullptr, timestamp, lifetime, timeout);
+  if(method=="plotlyplots"){
+    std::vector<std::string_view> elements;
+    JsonUtils::SplitArray(arg["traces"], elements);
+    std::vector<std::string> traces;
+    for(std::string_view element : elements) traces.push_back(JsonUtils::Unquote(element));
+    return m_central->SendPlotlyPlot(arg["name"], traces, arg["layout"], nullptr, timestamp, lifetime, timeout);
+  }
+  
+  return true;
+  
+}
+
+bool LocalDBBackend::Sync(){
+  
+  if(!m_central) return false;
+  std::lock_guard<std::mutex> sync_lock(m_sync_mtx);
+  
+  while(true){
+    
+    std::vector<std::pair<int64_t, std::pair<std::string, std::string> > > batch;
+    {
+      std::lock_guard<std::mutex> lock(m_db_mtx);
+      std::string error;
+      if(!Run("SELECT id, method, args FROM outbox ORDER BY id LIMIT 100", {}, error, [&batch](sqlite3_stmt* stmt){
+            batch.push_back({sqlite3_column_int64(stmt, 0), {Text(stmt, 1), Text(stmt, 2)}});
+          })) return false;
+    }
+    if(batch.empty()) return true;
+    
+    for(const std::pair<int64_t, std::pair<std::string, std::string> >& entry : batch){
+      if(!Replay(entry.second.first, entry.second.second)) return false; // keep the order; try again next period
+      std::lock_guard<std::mutex> lock(m_db_mtx);
+      std::string error;
+      Run("DELETE FROM outbox WHERE id=?", {entry.first}, error);
+      ++m_synced;
+    }
+    
+  }
+  
+}
+
+unsigned long LocalDBBackend::Synced(){
+  
+  return m_synced;
+  
+}
+
+unsigned long LocalDBBackend::Cancelled(){
+  
+  return m_cancelled;
+  
+}
+
+unsigned long LocalDBBackend::Unsynced(){
+  
+  unsigned long count=0;
+  std::lock_guard<std::mutex> lock(m_db_mtx);
+  std::string error;
+  Run("SELECT COUNT(*) FROM outbox", {}, error, [&count](sqlite3_stmt* stmt){ count = sqlite3_column_int64(stmt, 0); });
+  
+  return count;
+  
+}
+
+void LocalDBBackend::SyncThread(){
+  
+  std::unique_lock<std::mutex> lock(m_thread_mtx);
+  while(m_running){
+    // a period of 0 leaves syncing to explicit Sync() calls
+    if(m_sync_period_s) m_thread_cv.wait_for(lock, std::chrono::seconds(m_sync_period_s));
+    else m_thread_cv.wait(lock);
+    if(!m_running || !m_sync_period_s) continue;
+    lock.unlock();
+    Sync();
+    lock.lock();
+  }
+  
+}
+
+bool LocalDBBackend::Reload(Store& vars){
+  
+  unsigned int sync_period_s=m_sync_period_s;
+  vars.Get("local_db_sync_s",sync_period_s);
+  if(sync_period_s!=m_sync_period_s){
+    std::lock_guard<std::mutex> lock(m_thread_mtx);
+    m_sync_period_s=sync_period_s;
+    m_thread_cv.notify_all();
+  }
+  
+  return m_central && m_central->Reload(vars); // the network settings are unused without one
+  
+}
+
+// ==================================================================================================
+// DAQBackend
+
+bool LocalDBBackend::SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout){
+  
+  responses.clear();
+  std::lock_guard<std::mutex> lock(m_db_mtx);
+  std::string error;
+  if(!Run(query, {}, error, [&responses](sqlite3_stmt* stmt){ responses.push_back(RowJson(stmt)); }, timeout)){
+    responses.assign(1, error);
+    return false;
+  }
+  
+  return true;
+  
+}
+
+bool LocalDBBackend::SQLQuery(const std::string& query, std::string& response, const unsigned int timeout){
+  
+  response.clear();
+  bool first=true;
+  std::lock_guard<std::mutex> lock(m_db_mtx);
+  
+  return Run(query, {}, response, [&response, &first](sqlite3_stmt* stmt){
+      if(first) response = RowJson(stmt);
+      first=false;
+    }, timeout);
+    
+}
+
+bool LocalDBBackend::SQLQuery(const std::string& query, const unsigned int timeout){
+  
+  std::string response;
+  return SQLQuery(query, response, timeout);
+  
+}
+
+bool LocalDBBackend::SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp){
+  
+  uint64_t ms = timestamp ? timestamp : NowMs();
+  JsonUtils::Writer outbox;
+  outbox.AddString("message", message).AddNumber("severity", static_cast<int>(severity)).AddString("device", Device(device)).AddNumber("timestamp", ms);
+  
+  return Insert("logging", {"time", "device", "severity", "message"}, {FormatTime(ms), Device(device), static_cast<int64_t>(severity), message}, false, nullptr, outbox.str());
+  
+}
+
+bool LocalDBBackend::SendAlarm(const std::string& message, bool critical, const std::string& device, const uint64_t timestamp, const unsigned int timeout){
+  
+  uint64_t ms = timestamp ? timestamp : NowMs();
+  JsonUtils::Writer outbox;
+  outbox.AddString("message", message).AddNumber("critical", critical).AddString("device", Device(device)).AddNumber("timestamp", ms);
+  
+  return Insert("alarms", {"time", "device", "critical", "message"}, {FormatTime(ms), Device(device), static_cast<int64_t>(critical), message}, false, nullptr, outbox.str());
+  
+}
+
+bool LocalDBBackend::SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp){
+  
+  uint64_t ms = timestamp ? timestamp : NowMs();
+  JsonUtils::Writer outbox;
+  outbox.AddString("data", json_data).AddString("subject", subject).AddString("device", Device(device)).AddNumber("timestamp", ms);
+  
+  return Insert("monitoring", {"time", "device", "subject", "data"}, {FormatTime(ms), Device(device), subject, json_data}, false, nullptr, outbox.str());
+  
+}
+
+bool LocalDBBackend::SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
+  
+  uint64_t ms = timestamp ? timestamp : NowMs();
+  JsonUtils::Writer outbox;
+  outbox.AddString("data", json_data).AddString("description", description).AddString("device", Device(device)).AddNumber("timestamp", ms);
+  
+  return Insert("calibration", {"time", "device", "description", "data"}, {FormatTime(ms), Device(device), description, json_data}, true, version, outbox.str());
+  
+}
+
+bool LocalDBBackend::GetCalibrationData(std::string& json_data, int& version, const std::string& device, const unsigned int timeout){
+  
+  std::vector<std::string> columns;
+  if(!Select(version<0 ? "SELECT version, data FROM calibration WHERE device=? ORDER BY version DESC LIMIT 1"
+                       : "SELECT version, data FROM calibration WHERE device=? AND version=?",
+             {Device(device), static_cast<int64_t>(version)}, columns, json_data)) return false;
+  version = std::atoi(columns[0].c_str());
+  json_data = columns[1];
+  
+  return true;
+  
+}
+
+bool LocalDBBackend::SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
+  
+  uint64_t ms = timestamp ? timestamp : NowMs();
+  JsonUtils::Writer outbox;
+  outbox.AddString("data", json_data).AddString("author", author).AddString("description", description).AddString("device", Device(device)).AddNumber("timestamp", ms);
+  
+  return Insert("device_config", {"time", "device", "author", "description", "data"}, {FormatTime(ms), Device(device), author, description, json_data}, true, version, outbox.str());
+  
+}
+
+bool LocalDBBackend::GetDeviceConfig(std::string& json_data, const int version, const std::string& device, const unsigned int timeout){
+  
+  std::vector<std::string> columns;
+  if(!Select(version<0 ? "SELECT data FROM device_config WHERE device=? ORDER BY version DESC LIMIT 1"
+                       : "SELECT data FROM device_config WHERE device=? AND version=?",
+             {Device(device), static_cast<int64_t>(version)}, columns, json_data)) return false;
+  json_data = columns[0];
+  
+  return true;
+  
+}
+
+bool LocalDBBackend::GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout){
+  
+  // the runmode config's entries override the base config's
+  std::vector<std::string> columns;
+  if(!Select("SELECT json_patch(b.data, r.data) FROM base_config b, runmode_config r WHERE b.config_id=? AND r.config_id=?",
+             {static_cast<int64_t>(base_config_id), static_cast<int64_t>(runmode_config_id)}, columns, json_data)) return false;
+  json_data = columns[0];
+  
+  return true;
+  
+}
+
+bool LocalDBBackend::GetRunModeConfig(std::string& json_data, const std::string& name, const int version, const unsigned int timeout){
+  
+  std::vector<std::string> columns;
+  if(!Select(version<0 ? "SELECT data FROM runmode_config WHERE name=? ORDER BY version DESC LIMIT 1"
+                       : "SELECT data FROM runmode_config WHERE name=? AND version=?",
+             {name, static_cast<int64_t>(version)}, columns, json_data)) return false;
+  json_data = columns[0];
+  
+  return true;
+  
+}
+
+bool LocalDBBackend::GetRunDeviceConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, int* version, const unsigned int timeout){
+  
+  // the run config maps each device to the version of its device config
+  std::vector<std::string> columns;
+  if(!Select("SELECT d.version, d.data FROM base_config b, runmode_config r, device_config d WHERE b.config_id=? AND r.config_id=? "
+             "AND d.device=? AND d.version=json_extract(json_patch(b.data, r.data), '$.\"'||?||'\"')",
+             {static_cast<int64_t>(base_config_id), static_cast<int64_t>(runmode_config_id), Device(device), Device(device)}, columns, json_data)) return false;
+  if(version) *version = std::atoi(columns[0].c_str());
+  json_data = columns[1];
+  
+  return true;
+  
+}
+
+bool LocalDBBackend::SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  uint64_t ms = timestamp ? timestamp : NowMs();
+  JsonUtils::Writer outbox;
+  outbox.AddString("name", plot_name).AddString("draw_options", draw_options).AddString("data", json_data).AddNumber("timestamp", ms).AddNumber("lifetime", lifetime);
+  
+  return Insert("rootplots", {"time", "name", "draw_options", "data", "lifetime"}, {FormatTime(ms), plot_name, draw_options, json_data, static_cast<int64_t>(lifetime)}, true, version, outbox.str());
+  
+}
+
+bool LocalDBBackend::GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int& version, const unsigned int timeout){
+  
+  std::vector<std::string> columns;
+  if(!Select(version<0 ? "SELECT version, draw_options, data FROM rootplots WHERE name=? ORDER BY version DESC LIMIT 1"
+                       : "SELECT version, draw_options, data FROM rootplots WHERE name=? AND version=?",
+             {plot_name, static_cast<int64_t>(version)}, columns, json_data)) return false;
+  version = std::atoi(columns[0].c_str());
+  draw_options = columns[1];
+  json_data = columns[2];
+  
+  return true;
+  
+}
+
+bool LocalDBBackend::SendPlotlyPlot(const std::string& name, const std::string& json_trace, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  return SendPlotlyPlot(name, std::vector<std::string>{json_trace}, json_layout, version, timestamp, lifetime, timeout);
+  
+}
+
+bool LocalDBBackend::SendPlotlyPlot(const std::string& name, const std::vector<std::string>& json_traces, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  // one trace is stored as itself, several as a JSON array of them
+  std::string data = json_traces.size()==1 ? json_traces[0] : "[";
+  if(json_traces.size()!=1){
+    for(size_t i=0; i<json_traces.size(); i++) data += (i ? "," : "") + json_traces[i];
+    data += "]";
+  }
+  
+  uint64_t ms = timestamp ? timestamp : NowMs();
+  std::string traces = "[";
+  for(size_t i=0; i<json_traces.size(); i++) traces += (i ? "," : "") + JsonUtils::Quote(json_traces[i]);
+  traces += "]";
+  JsonUtils::Writer outbox;
+  outbox.AddString("name", name).AddRaw("traces", traces).AddString("layout", json_layout).AddNumber("timestamp", ms).AddNumber("lifetime", lifetime);
+  
+  return Insert("plotlyplots", {"time", "name", "data", "layout", "lifetime"}, {FormatTime(ms), name, data, json_layout, static_cast<int64_t>(lifetime)}, true, version, outbox.str());
+  
+}
+
+bool LocalDBBackend::GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int& version, const unsigned int timeout){
+  
+  std::vector<std::string> columns;
+  if(!Select(version<0 ? "SELECT version, data, layout FROM plotlyplots WHERE name=? ORDER BY version DESC LIMIT 1"
+                       : "SELECT version, data, layout FROM plotlyplots WHERE name=? AND version=?",
+             {name, static_cast<int64_t>(version)}, columns, json_trace)) return false;
+  version = std::atoi(columns[0].c_str());
+  json_trace = columns[1];
+  json_layout = columns[2];
+  
+  return true;
+  
+}
@@ -0,0 +1,193 @@
+#include <MonitoringAggregator.h>
+#include <JsonUtils.h>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+
+using namespace ToolFramework;
+
+MonitoringAggregator::MonitoringAggregator(std::function<bool(const std::string&, const std::string&)> send_function, const unsigned int window_ms, const unsigned int max_fields) : m_send_function(send_function), m_window_ms(window_ms ? window_ms : 1000), m_max_fields(max_fields){
+  
+  // accumulators are preallocated so Record never allocates or races with a resize
+  m_banks[0] = std::vector<Accumulator>(m_max_fields);
+  m_banks[1] = std::vector<Accumulator>(m_max_fields);
+  for(unsigned int i=0; i<m_max_fields; ++i){
+    m_banks[0][i].Reset();
+    m_banks[1][i].Reset();
+  }
+  m_writers[0]=0;
+  m_writers[1]=0;
+  m_fields.reserve(m_max_fields);
+  
+  m_running=true;
+  m_thread = std::thread(&MonitoringAggregator::Thread, this);
+  
+}
+
+MonitoringAggregator::~MonitoringAggregator(){
+  
+  {
+    std::lock_guard<std::mutex> lock(m_thread_mtx);
+    m_running=false;
+  }
+  m_thread_cv.notify_all();
+  m_thread.join();
+  
+  Flush(); // don't lose the partial window
+  
+}
+
+void MonitoringAggregator::Accumulator::Reset(){
+  
+  count.store(0, std::memory_order_relaxed);
+  sum.store(0, std::memory_order_relaxed);
+  sum_squares.store(0, std::memory_order_relaxed);
+  min.store(std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+  max.store(-std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+  
+}
+
+int MonitoringAggregator::Register(const std::string& subject, const std::string& field){
+  
+  std::unique_lock<std::shared_mutex> lock(m_fields_mtx);
+  
+  std::map<std::pair<std::string, std::string>, int>::iterator it = m_handles.find({subject, field});
+  if(it!=m_handles.end()) return it->second;
+  if(m_fields.size()>=m_max_fields) return -1;
+  
+  int handle = m_fields.size();
+  m_fields.push_back({subject, field});
+  m_handles[{subject, field}] = handle;
+  m_num_fields.store(m_fields.size());
+  
+  return handle;
+  
+}
+
+void MonitoringAggregator::Record(const int handle, const double value){
+  
+  if(handle<0 || static_cast<unsigned int>(handle)>=m_num_fields.load(std::memory_order_acquire)) return;
+  
+  // announce ourselves as a writer of the active bank, retrying if the reducer flipped banks meanwhile
+  unsigned int bank;
+  while(true){
+    bank = m_active_bank.load();
+    m_writers[bank].fetch_add(1);
+    if(m_active_bank.load()==bank) break;
+    m_writers[bank].fetch_sub(1);
+  }
+  
+  Accumulator& acc = m_banks[bank][handle];
+  
+  acc.count.fetch_add(1, std::memory_order_relaxed);
+  acc.sum.fetch_add(value, std::memory_order_relaxed);
+  acc.sum_squares.fetch_add(value*value, std::memory_order_relaxed);
+  
+  double current = acc.min.load(std::memory_order_relaxed);
+  while(value<current && !acc.min.compare_exchange_weak(current, value, std::memory_order_relaxed));
+  current = acc.max.load(std::memory_order_relaxed);
+  while(value>current && !acc.max.compare_exchange_weak(current, value, std::memory_order_relaxed));
+  
+  m_writers[bank].fetch_sub(1);
+  
+}
+
+bool MonitoringAggregator::Record(const std::string& subject, const std::string& field, const double value){
+  
+  int handle=-1;
+  {
+    std::shared_lock<std::shared_mutex> lock(m_fields_mtx);
+    std::map<std::pair<std::string, std::string>, int>::iterator it = m_handles.find({subject, field});
+    if(it!=m_handles.end()) handle = it->second;
+  }
+  if(handle<0) handle = Register(subject, field);
+  if(handle<0) return false;
+  
+  Record(handle, value);
+  
+  return true;
+  
+}
+
+bool MonitoringAggregator::Flush(){
+  
+  std::lock_guard<std::mutex> flush_lock(m_flush_mtx);
+  
+  unsigned int bank = m_active_bank.load();
+  m_active_bank.store(1-bank);
+  while(m_writers[bank].load()!=0) std::this_thread::yield();
+  
+  std::map<std::string, std::ostringstream> subjects;
+  {
+    std::shared_lock<std::shared_mutex> lock(m_fields_mtx);
+    
+    for(size_t i=0; i<m_fields.size(); ++i){
+      
+      Accumulator& acc = m_banks[bank][i];
+      uint64_t count = acc.count.load(std::memory_order_relaxed);
+      if(count==0) continue;
+      
+      double mean = acc.sum.load(std::memory_order_relaxed)/count;
+      double variance = acc.sum_squares.load(std::memory_order_relaxed)/count - mean*mean;
+      
+      std::ostringstream& json = subjects[m_fields[i].subject];
+      json<<std::setprecision(10)<<(json.tellp()>0 ? "," : "{");
+      const std::string& name = m_fields[i].name;
+      json<<JsonUtils::Quote(name+"_min")<<":"<<acc.min.load(std::memory_order_relaxed)
+          <<","<<JsonUtils::Quote(name+"_max")<<":"<<acc.max.load(std::memory_order_relaxed)
+          <<","<<JsonUtils::Quote(name+"_mean")<<":"<<mean
+          <<","<<JsonUtils::Quote(name+"_rms")<<":"<<std::sqrt(variance>0 ? variance : 0)
+          <<","<<JsonUtils::Quote(name+"_count")<<":"<<count;
+      
+      acc.Reset();
+      
+    }
+  }
+  
+  bool ok=true;
+  for(std::pair<const std::string, std::ostringstream>& subject : subjects){
+    subject.second<<"}";
+    ok = m_send_function(subject.second.str(), subject.first) && ok;
+  }
+  
+  return ok;
+  
+}
+
+void MonitoringAggregator::SetWindow(const unsigned int window_ms){
+  
+  if(window_ms==0) return;
+  m_window_ms = window_ms;
+  m_thread_cv.notify_all();
+  
+}
+
+unsigned int MonitoringAggregator::GetWindow(){
+  
+  return m_window_ms;
+  
+}
+
+void MonitoringAggregator::Thread(){
+  
+  std::unique_lock<std::mutex> lock(m_thread_mtx);
+  std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_window_ms);
+  
+  while(m_running){
+    
+    if(m_thread_cv.wait_until(lock, next)==std::cv_status::timeout){
+      lock.unlock();
+      Flush();
+      lock.lock();
+      next += std::chrono::milliseconds(m_window_ms);
+      // don't try to catch up on windows missed while the sends were slow
+      if(next<std::chrono::steady_clock::now()) next = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_window_ms);
+    } else {
+      // woken by SetWindow or shutdown
+      next = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_window_ms);
+    }
+    
+  }
+  
+}
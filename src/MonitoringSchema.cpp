@@ -0,0 +1,301 @@
+#include <MonitoringSchema.h>
+#include <UploadDeduplicator.h>
+#include <JsonUtils.h>
+#include <cmath>
+#include <bit>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+#include <iomanip>
+
+using namespace ToolFramework;
+
+const std::string MonitoringSchema::announce_subject="monitoring_schema";
+
+namespace {
+  
+  const char base64_chars[]="ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  
+  void Base64Encode(const std::string& in, std::string& out){
+    
+    out.reserve(out.size() + (in.size()+2)/3*4);
+    size_t i=0;
+    for(; i+2<in.size(); i+=3){
+      uint32_t n = (uint8_t(in[i])<<16) | (uint8_t(in[i+1])<<8) | uint8_t(in[i+2]);
+      out += base64_chars[(n>>18)&63];
+      out += base64_chars[(n>>12)&63];
+      out += base64_chars[(n>>6)&63];
+      out += base64_chars[n&63];
+    }
+    if(i<in.size()){
+      uint32_t n = uint8_t(in[i])<<16;
+      if(i+1<in.size()) n |= uint8_t(in[i+1])<<8;
+      out += base64_chars[(n>>18)&63];
+      out += base64_chars[(n>>12)&63];
+      out += (i+1<in.size()) ? base64_chars[(n>>6)&63] : '=';
+      out += '=';
+    }
+    
+  }
+  
+  bool Base64Decode(const std::string& in, std::string& out){
+    
+    out.clear();
+    uint32_t n=0;
+    int bits=0;
+    for(char c : in){
+      if(c=='=') break;
+      const char* pos = std::strchr(base64_chars, c);
+      if(!pos || !c) return false;
+      n = (n<<6) | uint32_t(pos-base64_chars);
+      bits += 6;
+      if(bits>=8){
+        bits -= 8;
+        out += char((n>>bits)&0xFF);
+      }
+    }
+    
+    return true;
+    
+  }
+  
+  // values go on the wire little-endian whatever the host
+  template<typename T> void Pack(std::string& out, const T value){
+    
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if constexpr(std::endian::native==std::endian::big) std::reverse(bytes, bytes+sizeof(T));
+    out.append(bytes, sizeof(T));
+    
+  }
+  
+  template<typename T> bool Unpack(const std::string& in, size_t& pos, T& value){
+    
+    if(pos+sizeof(T)>in.size()) return false;
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, in.data()+pos, sizeof(T));
+    if constexpr(std::endian::native==std::endian::big) std::reverse(bytes, bytes+sizeof(T));
+    std::memcpy(&value, bytes, sizeof(T));
+    pos += sizeof(T);
+    
+    return true;
+    
+  }
+  
+  void PackVarint(std::string& out, const int64_t value){
+    
+    uint64_t zigzag = (uint64_t(value)<<1) ^ uint64_t(value>>63);
+    while(zigzag>=0x80){
+      out += char((zigzag&0x7F)|0x80);
+      zigzag >>= 7;
+    }
+    out += char(zigzag);
+    
+  }
+  
+  bool UnpackVarint(const std::string& in, size_t& pos, int64_t& value){
+    
+    uint64_t zigzag=0;
+    for(int shift=0; shift<64; shift+=7){
+      if(pos>=in.size()) return false;
+      uint8_t byte = in[pos++];
+      zigzag |= uint64_t(byte&0x7F)<<shift;
+      if(!(byte&0x80)){
+        value = int64_t(zigzag>>1) ^ -int64_t(zigzag&1);
+        return true;
+      }
+    }
+    
+    return false;
+    
+  }
+  
+  std::string Number(const double value, const int precision){
+    
+    if(!std::isfinite(value)) return "null";
+    std::ostringstream out;
+    out<<std::setprecision(precision)<<value; // the digits the stored type actually carries
+    
+    return out.str();
+    
+  }
+  
+}
+
+MonitoringSchema::MonitoringSchema(std::function<bool(std::string&&, const std::string&)> send_function, const unsigned int announce_s) : m_send_function(send_function), m_announce_period(announce_s){}
+
+std::string MonitoringSchema::Id(const uint32_t schema_id){
+  
+  char id[9];
+  snprintf(id, sizeof(id), "%08x", schema_id);
+  
+  return id;
+  
+}
+
+uint32_t MonitoringSchema::Register(const std::string& subject, const std::vector<std::pair<std::string, SchemaFieldType> >& fields){
+  
+  if(fields.empty()) return 0;
+  
+  std::vector<std::string> layout;
+  std::string canonical = subject;
+  for(const std::pair<std::string, SchemaFieldType>& field : fields){
+    layout.push_back(field.first + ':' + static_cast<char>(field.second));
+    canonical += '\n' + layout.back();
+  }
+  uint64_t hash = UploadDeduplicator::Hash({canonical});
+  uint32_t schema_id = static_cast<uint32_t>(hash ^ (hash>>32));
+  if(schema_id==0) schema_id=1;
+  
+  std::unique_lock<std::shared_mutex> lock(m_mtx);
+  Schema& schema = m_schemas[schema_id];
+  if(schema.fields.empty()){
+    schema.subject = subject;
+    schema.fields = fields;
+    schema.announcement = JsonUtils::Writer().AddString("schema", Id(schema_id)).AddString("subject", subject).AddStrings("fields", layout).str();
+  }
+  // another layout with the same 32-bit id; taking the next free id instead would break ids being the same on every device
+  else if(schema.subject!=subject || schema.fields!=fields) return 0;
+  
+  return schema_id;
+  
+}
+
+bool MonitoringSchema::Encode(const uint32_t schema_id, const std::vector<double>& values, std::string& json_data, std::string& subject){
+  
+  std::shared_lock<std::shared_mutex> lock(m_mtx);
+  std::map<uint32_t, Schema>::iterator it = m_schemas.find(schema_id);
+  if(it==m_schemas.end() || values.size()!=it->second.fields.size()) return false;
+  
+  std::string packed;
+  packed.reserve(values.size()*sizeof(double));
+  for(size_t i=0; i<values.size(); ++i){
+    switch(it->second.fields[i].second){
+    case SchemaFieldType::Float: Pack<float>(packed, static_cast<float>(values[i])); break;
+    case SchemaFieldType::Double: Pack<double>(packed, values[i]); break;
+    case SchemaFieldType::Int: PackVarint(packed, std::llround(values[i])); break;
+    }
+  }
+  
+  json_data = "{\"schema\":\"" + Id(schema_id) + "\",\"values\":\"";
+  Base64Encode(packed, json_data);
+  json_data += "\"}";
+  subject = it->second.subject;
+  
+  return true;
+  
+}
+
+bool MonitoringSchema::Send(const uint32_t schema_id, const std::vector<double>& values){
+  
+  if(!m_send_function) return false;
+  
+  std::string json_data;
+  std::string subject;
+  if(!Encode(schema_id, values, json_data, subject)) return false;
+  
+  // announce before the first message that uses the schema, then periodically for anyone who joined late
+  std::string announcement;
+  {
+    std::lock_guard<std::mutex> announce_lock(m_announce_mtx);
+    std::shared_lock<std::shared_mutex> lock(m_mtx);
+    Schema& schema = m_schemas.find(schema_id)->second; // Encode found it, and schemas are never removed
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(!schema.ever_announced || now - schema.announced >= m_announce_period){
+      schema.ever_announced = true;
+      schema.announced = now;
+      announcement = schema.announcement;
+    }
+  }
+  if(!announcement.empty()) m_send_function(std::move(announcement), announce_subject);
+  
+  return m_send_function(std::move(json_data), subject);
+  
+}
+
+bool MonitoringSchema::Learn(const std::string& announcement){
+  
+  std::vector<std::pair<std::string, std::string_view> > members;
+  if(!JsonUtils::SplitObject(announcement, members)) return false;
+  
+  std::string id;
+  Schema schema;
+  std::vector<std::string_view> layout;
+  for(const std::pair<std::string, std::string_view>& member : members){
+    if(member.first=="schema") id = JsonUtils::Unquote(member.second);
+    else if(member.first=="subject") schema.subject = JsonUtils::Unquote(member.second);
+    else if(member.first=="fields" && !JsonUtils::SplitArray(member.second, layout)) return false;
+  }
+  if(id.empty() || layout.empty()) return false;
+  
+  for(std::string_view entry : layout){
+    std::string field = JsonUtils::Unquote(entry);
+    if(field.size()<3 || field[field.size()-2]!=':') return false;
+    char type = field.back();
+    if(type!='f' && type!='d' && type!='i') return false;
+    schema.fields.emplace_back(field.substr(0, field.size()-2), static_cast<SchemaFieldType>(type));
+  }
+  schema.announcement = announcement;
+  
+  uint32_t schema_id = static_cast<uint32_t>(std::strtoul(id.c_str(), nullptr, 16));
+  std::unique_lock<std::shared_mutex> lock(m_mtx);
+  m_schemas[schema_id] = std::move(schema);
+  
+  return true;
+  
+}
+
+bool MonitoringSchema::IsCompact(const std::string& json_data){
+  
+  return json_data.compare(0, 11, "{\"schema\":\"")==0 && json_data.find("\"values\":")!=std::string::npos;
+  
+}
+
+bool MonitoringSchema::Expand(const std::string& json_data, std::string& expanded, std::string* subject){
+  
+  std::vector<std::pair<std::string, std::string_view> > members;
+  if(!JsonUtils::SplitObject(json_data, members)) return false;
+  
+  std::string id;
+  std::string encoded;
+  for(const std::pair<std::string, std::string_view>& member : members){
+    if(member.first=="schema") id = JsonUtils::Unquote(member.second);
+    else if(member.first=="values") encoded = JsonUtils::Unquote(member.second);
+  }
+  std::string packed;
+  if(id.empty() || !Base64Decode(encoded, packed)) return false;
+  
+  std::shared_lock<std::shared_mutex> lock(m_mtx);
+  std::map<uint32_t, Schema>::iterator it = m_schemas.find(static_cast<uint32_t>(std::strtoul(id.c_str(), nullptr, 16)));
+  if(it==m_schemas.end()) return false; // not announced yet
+  
+  expanded = "{";
+  size_t pos=0;
+  for(const std::pair<std::string, SchemaFieldType>& field : it->second.fields){
+    if(expanded.size()>1) expanded += ',';
+    expanded += JsonUtils::Quote(field.first) + ':';
+    bool ok=false;
+    if(field.second==SchemaFieldType::Float){
+      float value;
+      ok = Unpack(packed, pos, value);
+      if(ok) expanded += Number(value, 7);
+    }
+    else if(field.second==SchemaFieldType::Double){
+      double value;
+      ok = Unpack(packed, pos, value);
+      if(ok) expanded += Number(value, 17);
+    }
+    else{
+      int64_t value;
+      ok = UnpackVarint(packed, pos, value);
+      if(ok) expanded += std::to_string(value);
+    }
+    if(!ok) return false;
+  }
+  expanded += '}';
+  if(subject) *subject = it->second.subject;
+  
+  return pos==packed.size();
+  
+}
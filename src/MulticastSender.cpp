@@ -0,0 +1,177 @@
+#include <MulticastSender.h>
+#include <random>
+
+using namespace ToolFramework;
+
+MulticastSender::MulticastSender(DAQBackend* backend, const size_t queue_size, const size_t max_payload, const unsigned int block_ms) : m_backend(backend), m_queue(nullptr), m_max_payload(max_payload), m_block_ms(block_ms), m_running(false), m_idle(false), m_sent(0), m_failed(0), m_dropped(0), m_fragmented(0){
+  
+  // fragment ids only need to be unique per sender; a random start keeps restarts from reusing them
+  std::random_device random;
+  m_next_fragment_id = (static_cast<uint64_t>(random())<<32) | random();
+  
+  if(queue_size==0) return;
+  
+  m_queue = new MPMCQueue<Message>(queue_size);
+  m_running=true;
+  m_thread = std::thread(&MulticastSender::Thread, this);
+  
+}
+
+MulticastSender::~MulticastSender(){
+  
+  if(m_queue){
+    m_running=false;
+    {
+      std::lock_guard<std::mutex> lock(m_idle_mtx);
+      m_idle_cv.notify_all();
+    }
+    m_thread.join(); // drains the queue before returning
+    delete m_queue;
+    m_queue=nullptr;
+  }
+  
+}
+
+bool MulticastSender::SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp){
+  
+  return SendLog(std::string(message), severity, device, timestamp); // the one copy the queue needs
+  
+}
+
+bool MulticastSender::SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp){
+  
+  return SendMonitoringData(std::string(json_data), subject, device, timestamp);
+  
+}
+
+bool MulticastSender::SendLog(std::string&& message, LogLevel severity, const std::string& device, const uint64_t timestamp){
+  
+  Message msg;
+  msg.log=true;
+  msg.payload=std::move(message);
+  msg.device=device;
+  msg.severity=severity;
+  msg.timestamp=timestamp;
+  
+  return Submit(std::move(msg));
+  
+}
+
+bool MulticastSender::SendMonitoringData(std::string&& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp){
+  
+  Message msg;
+  msg.log=false;
+  msg.payload=std::move(json_data);
+  msg.subject=subject;
+  msg.device=device;
+  msg.timestamp=timestamp;
+  
+  return Submit(std::move(msg));
+  
+}
+
+bool MulticastSender::Submit(Message&& message){
+  
+  if(!m_queue){
+    std::lock_guard<std::mutex> lock(m_send_mtx);
+    return Send(message);
+  }
+  
+  if(!message.timestamp) message.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  
+  // a full queue means the sender thread is behind: wait for it rather than overtake what's queued
+  std::chrono::steady_clock::time_point give_up = std::chrono::steady_clock::now()+std::chrono::milliseconds(m_block_ms);
+  while(!m_queue->Push(std::move(message))){
+    if(std::chrono::steady_clock::now()>=give_up){
+      ++m_dropped;
+      return false;
+    }
+    Wake();
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  
+  // only pay for a notify if the sender thread has gone to sleep
+  if(m_idle.load(std::memory_order_relaxed)) Wake();
+  
+  return true;
+  
+}
+
+void MulticastSender::Wake(){
+  
+  std::lock_guard<std::mutex> lock(m_idle_mtx);
+  m_idle_cv.notify_one();
+  
+}
+
+bool MulticastSender::Send(const Message& message){
+  
+  bool ok=true;
+  if(FragmentReassembler::Split(message.payload, m_max_payload, m_next_fragment_id, m_fragments)){
+    ++m_next_fragment_id;
+    ++m_fragmented;
+    for(const std::string& fragment : m_fragments) ok = SendPayload(message, fragment) && ok;
+  }
+  else ok = SendPayload(message, message.payload);
+  
+  if(ok) ++m_sent;
+  else ++m_failed;
+  
+  return ok;
+  
+}
+
+bool MulticastSender::SendPayload(const Message& message, const std::string& payload){
+  
+  return message.log ? m_backend->SendLog(payload, message.severity, message.device, message.timestamp)
+                     : m_backend->SendMonitoringData(payload, message.subject, message.device, message.timestamp);
+  
+}
+
+void MulticastSender::Thread(){
+  
+  Message message;
+  
+  while(true){
+    
+    if(m_queue->Pop(message)){
+      std::lock_guard<std::mutex> lock(m_send_mtx);
+      Send(message);
+      continue;
+    }
+    
+    if(!m_running) return;
+    
+    // the timeout covers a producer that pushed just before we flagged ourselves idle
+    std::unique_lock<std::mutex> lock(m_idle_mtx);
+    m_idle=true;
+    m_idle_cv.wait_for(lock, std::chrono::milliseconds(10));
+    m_idle=false;
+    
+  }
+  
+}
+
+unsigned long MulticastSender::Sent(){
+  
+  return m_sent;
+  
+}
+
+unsigned long MulticastSender::Failed(){
+  
+  return m_failed;
+  
+}
+
+unsigned long MulticastSender::Dropped(){
+  
+  return m_dropped;
+  
+}
+
+unsigned long MulticastSender::Fragmented(){
+  
+  return m_fragmented;
+  
+}
@@ -0,0 +1,375 @@
+#include <NetworkBackend.h>
+#include <random>
+#include <iostream>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  // settings consumed by Services::Init; a change to any of them on reload recreates the services
+  const char* services_keys[]={"max_retries", "resend_period_ms", "print_stats_period_ms", "clt_pub_port", "clt_dlr_port", "clt_pub_socket_timeout", "clt_dlr_socket_timeout",
+                               "inpoll_timeout", "outpoll_timeout", "command_timeout", "log_port", "mon_port", "log_address", "mon_address"};
+  
+  std::map<std::string, std::string> ServicesSettings(Store& vars){
+    
+    std::map<std::string, std::string> settings;
+    for(const char* key : services_keys) vars.Get(key, settings[key]);
+    
+    return settings;
+    
+  }
+  
+  std::chrono::steady_clock::time_point Deadline(const unsigned int timeout){
+    
+    return std::chrono::steady_clock::now()+std::chrono::milliseconds(timeout);
+    
+  }
+  
+}
+
+NetworkBackend::NetworkBackend(Store& vars, SlowControlCollection* sc_vars, SpanTracer* spans) : m_spans(spans), m_sc_vars(sc_vars), m_beacon_period(0), m_request_failed(false), m_request_succeeded(false), m_sd_restart(false), m_running(true){
+  
+  vars.Get("service_name",m_name);
+  
+  std::string s_uuid;
+  if(vars.Get("UUID",s_uuid)){
+    m_UUID = boost::uuids::string_generator{}(s_uuid);
+  } else {
+    m_UUID = boost::uuids::random_generator()();
+  }
+  
+  vars.Get("service_discovery_address",m_sd_address);
+  vars.Get("service_discovery_port",m_sd_port);
+  vars.Get("service_discovery_remote_port",m_sd_remote_port);
+  unsigned int beacon_s=m_sd_beacon_s;
+  vars.Get("service_discovery_beacon_s",beacon_s);
+  vars.Get("service_discovery_beacon_max_s",m_sd_beacon_max_s);
+  vars.Get("service_discovery_kick_s",m_sd_kick_s);
+  vars.Get("service_discovery_jitter_ms",m_sd_jitter_ms);
+  bool adaptive=false;
+  vars.Get("service_discovery_adaptive",adaptive);
+  m_sd_adaptive=adaptive;
+  m_sd_beacon_s = beacon_s ? beacon_s : 1;
+  if(m_sd_beacon_max_s<m_sd_beacon_s) m_sd_beacon_max_s=m_sd_beacon_s;
+  
+  m_context = new zmq::context_t(1);
+  m_sd_thread = std::thread(&NetworkBackend::DiscoveryThread, this);
+  
+  SpanTracer::Scope span(m_spans, "services_init", "discovery");
+  m_services= new Services();
+  m_services->Init(vars, m_context, sc_vars);
+  m_services_settings = ServicesSettings(vars);
+  
+}
+
+NetworkBackend::~NetworkBackend(){
+  
+  {
+    std::lock_guard<std::mutex> lock(m_sd_mtx);
+    m_running=false;
+  }
+  m_sd_cv.notify_all();
+  m_sd_thread.join();
+  
+  if(m_timed_out || m_late_replies) std::cerr<<"NetworkBackend: "<<m_timed_out<<" requests timed out, "<<m_late_replies<<" answered after their deadline"<<std::endl;
+  delete m_services;
+  m_services=0;
+  delete mp_SD;
+  mp_SD=0;
+  delete m_context;
+  m_context=0;
+  
+}
+
+void NetworkBackend::DiscoveryThread(){
+  
+  std::mt19937 rng(std::random_device{}());
+  std::unique_lock<std::mutex> lock(m_sd_mtx);
+  unsigned int period = m_sd_beacon_s;
+  
+  bool new_settings=true;
+  
+  while(m_running){
+    
+    if(new_settings){
+      std::uniform_int_distribution<unsigned int> jitter(0, m_sd_jitter_ms);
+      if(m_sd_cv.wait_for(lock, std::chrono::milliseconds(jitter(rng)), [this]{ return !m_running; })) break;
+    }
+    
+    m_sd_restart=false;
+    {
+      SpanTracer::Scope span(m_spans, "discovery_restart", "discovery");
+      delete mp_SD;
+      mp_SD = new ServiceDiscovery(true, false, m_sd_remote_port, m_sd_address, m_sd_port, m_context, m_UUID, m_name, period, m_sd_kick_s);
+    }
+    m_beacon_period = period;
+    
+    // hold this period until requests have succeeded, with none failing, for four periods, or one fails;
+    // a reload that changes the discovery settings restarts at the base period
+    unsigned int next = period;
+    while(m_running && !m_sd_restart && next==period){
+      if(!m_sd_adaptive){
+        m_sd_cv.wait(lock, [this]{ return !m_running || m_sd_restart; });
+        break;
+      }
+      m_request_failed=false;
+      m_request_succeeded=false;
+      bool failed = m_sd_cv.wait_for(lock, std::chrono::seconds(4*period), [this]{ return !m_running || m_sd_restart || m_request_failed.load(); });
+      if(!m_running || m_sd_restart) break;
+      if(failed) next = m_sd_beacon_s;
+      else if(m_request_succeeded) next = std::min(period*2, m_sd_beacon_max_s);
+    }
+    new_settings = m_sd_restart;
+    period = m_sd_restart ? m_sd_beacon_s.load() : next;
+    
+  }
+  
+}
+
+bool NetworkBackend::Reload(Store& vars){
+  
+  {
+    std::lock_guard<std::mutex> lock(m_sd_mtx);
+    std::string address=m_sd_address;
+    int port=m_sd_port;
+    int remote_port=m_sd_remote_port;
+    unsigned int beacon_s=m_sd_beacon_s;
+    unsigned int beacon_max_s=m_sd_beacon_max_s;
+    unsigned int kick_s=m_sd_kick_s;
+    bool adaptive=m_sd_adaptive;
+    vars.Get("service_discovery_address",address);
+    vars.Get("service_discovery_port",port);
+    vars.Get("service_discovery_remote_port",remote_port);
+    vars.Get("service_discovery_beacon_s",beacon_s);
+    vars.Get("service_discovery_beacon_max_s",beacon_max_s);
+    vars.Get("service_discovery_kick_s",kick_s);
+    vars.Get("service_discovery_jitter_ms",m_sd_jitter_ms); // only affects the next restart
+    vars.Get("service_discovery_adaptive",adaptive);
+    if(beacon_s==0) beacon_s=1;
+    if(beacon_max_s<beacon_s) beacon_max_s=beacon_s;
+    
+    if(address!=m_sd_address || port!=m_sd_port || remote_port!=m_sd_remote_port || beacon_s!=m_sd_beacon_s || beacon_max_s!=m_sd_beacon_max_s || kick_s!=m_sd_kick_s || adaptive!=m_sd_adaptive){
+      m_sd_address=address;
+      m_sd_port=port;
+      m_sd_remote_port=remote_port;
+      m_sd_beacon_s=beacon_s;
+      m_sd_beacon_max_s=beacon_max_s;
+      m_sd_kick_s=kick_s;
+      m_sd_adaptive=adaptive;
+      m_sd_restart=true;
+      m_sd_cv.notify_all();
+    }
+  }
+  
+  std::map<std::string, std::string> settings = ServicesSettings(vars);
+  if(settings!=m_services_settings){
+    // waits for calls in progress; the ZMQ context, discovery and slow controls carry on untouched
+    std::unique_lock<std::shared_mutex> lock(m_services_mtx);
+    SpanTracer::Scope span(m_spans, "services_init", "discovery");
+    delete m_services;
+    m_services = new Services();
+    m_services->Init(vars, m_context, m_sc_vars);
+    m_services_settings.swap(settings);
+  }
+  
+  return true;
+  
+}
+
+bool NetworkBackend::Track(const bool ok, const std::chrono::steady_clock::time_point deadline){
+  
+  if(ok) m_request_succeeded=true;
+  else if(m_sd_adaptive && !m_request_failed.exchange(true) && m_beacon_period>m_sd_beacon_s){ // at the base period it only holds the period
+    std::lock_guard<std::mutex> lock(m_sd_mtx);
+    m_sd_cv.notify_all();
+  }
+  
+  if(std::chrono::steady_clock::now()<=deadline) return ok;
+  // services has already enforced the timeout, so a reply that's in hand is kept: only count it
+  if(ok) ++m_late_replies;
+  else ++m_timed_out;
+  
+  return ok;
+  
+}
+
+unsigned long NetworkBackend::TimedOut(){
+  
+  return m_timed_out;
+  
+}
+
+unsigned long NetworkBackend::LateReplies(){
+  
+  return m_late_replies;
+  
+}
+
+const std::vector<std::string>& NetworkBackend::ReloadKeys(){
+  
+  static const std::vector<std::string> keys = [](){
+    std::vector<std::string> keys(std::begin(services_keys), std::end(services_keys));
+    keys.insert(keys.end(), {"service_discovery_address", "service_discovery_port", "service_discovery_remote_port", "service_discovery_beacon_s",
+                             "service_discovery_beacon_max_s", "service_discovery_kick_s", "service_discovery_jitter_ms", "service_discovery_adaptive"});
+    return keys;
+  }();
+  
+  return keys;
+  
+}
+
+unsigned int NetworkBackend::GetBeaconPeriod(){
+  
+  return m_beacon_period;
+  
+}
+
+bool NetworkBackend::SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->SQLQuery(query, responses, timeout), deadline);
+  
+}
+
+bool NetworkBackend::SQLQuery(const std::string& query, std::string& response, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->SQLQuery(query, response, timeout), deadline);
+  
+}
+
+bool NetworkBackend::SQLQuery(const std::string& query, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->SQLQuery(query, timeout), deadline);
+  
+}
+
+bool NetworkBackend::Probe(const std::string& query, std::string& response, const unsigned int timeout){
+  
+  // a probe may fail by design (e.g. a table this database doesn't have), so it says nothing about the middleman
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return m_services->SQLQuery(query, response, timeout);
+  
+}
+
+bool NetworkBackend::SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp){
+  
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return m_services->SendLog(message, severity, device, timestamp);
+  
+}
+
+bool NetworkBackend::SendAlarm(const std::string& message, bool critical, const std::string& device, const uint64_t timestamp, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->SendAlarm(message, critical, device, timestamp, timeout), deadline);
+  
+}
+
+bool NetworkBackend::SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp){
+  
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return m_services->SendMonitoringData(json_data, subject, device, timestamp);
+  
+}
+
+bool NetworkBackend::SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->SendCalibrationData(json_data, description, device, timestamp, version, timeout), deadline);
+  
+}
+
+bool NetworkBackend::GetCalibrationData(std::string& json_data, int& version, const std::string& device, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->GetCalibrationData(json_data, version, device, timeout), deadline);
+  
+}
+
+bool NetworkBackend::SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->SendDeviceConfig(json_data, author, description, device, timestamp, version, timeout), deadline);
+  
+}
+
+bool NetworkBackend::GetDeviceConfig(std::string& json_data, const int version, const std::string& device, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->GetDeviceConfig(json_data, version, device, timeout), deadline);
+  
+}
+
+bool NetworkBackend::GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->GetRunConfig(json_data, base_config_id, runmode_config_id, timeout), deadline);
+  
+}
+
+bool NetworkBackend::GetRunModeConfig(std::string& json_data, const std::string& name, const int version, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->GetRunModeConfig(json_data, name, version, timeout), deadline);
+  
+}
+
+bool NetworkBackend::GetRunDeviceConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, int* version, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->GetRunDeviceConfig(json_data, base_config_id, runmode_config_id, device, version, timeout), deadline);
+  
+}
+
+bool NetworkBackend::SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->SendROOTplot(plot_name, draw_options, json_data, version, timestamp, lifetime, timeout), deadline);
+  
+}
+
+bool NetworkBackend::GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int& version, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->GetROOTplot(plot_name, draw_options, json_data, version, timeout), deadline);
+  
+}
+
+bool NetworkBackend::SendPlotlyPlot(const std::string& name, const std::string& json_trace, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->SendPlotlyPlot(name, json_trace, json_layout, version, timestamp, lifetime, timeout), deadline);
+  
+}
+
+bool NetworkBackend::SendPlotlyPlot(const std::string& name, const std::vector<std::string>& json_traces, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->SendPlotlyPlot(name, json_traces, json_layout, version, timestamp, lifetime, timeout), deadline);
+  
+}
+
+bool NetworkBackend::GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int& version, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point deadline = Deadline(timeout);
+  std::shared_lock<std::shared_mutex> lock(m_services_mtx);
+  return Track(m_services->GetPlotlyPlot(name, json_trace, json_layout, version, timeout), deadline);
+  
+}
@@ -0,0 +1,102 @@
+#include <PlotCache.h>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  std::string Id(const std::string& key, const int version){
+    
+    return key+"#"+std::to_string(version);
+    
+  }
+  
+}
+
+PlotCache::PlotCache(const size_t max_bytes) : m_max_bytes(max_bytes), m_bytes(0), m_hits(0), m_misses(0){}
+
+PlotCache::Entry* PlotCache::Find(const std::string& key, const int version){
+  
+  std::unordered_map<std::string, std::list<Entry>::iterator>::iterator it = m_index.find(Id(key, version));
+  if(it==m_index.end()) return nullptr;
+  
+  m_lru.splice(m_lru.begin(), m_lru, it->second);
+  
+  return &(*it->second);
+  
+}
+
+void PlotCache::Evict(){
+  
+  // always keep the most recent entry, even if it alone is over the limit
+  while(m_bytes>m_max_bytes && m_lru.size()>1){
+    Entry& last = m_lru.back();
+    m_bytes -= last.first.size() + last.second.size() + last.parsed_bytes;
+    m_index.erase(last.id);
+    m_lru.pop_back();
+  }
+  
+}
+
+bool PlotCache::Get(const std::string& key, const int version, std::string& first, std::string& second){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  
+  Entry* entry = Find(key, version);
+  if(!entry){
+    ++m_misses;
+    return false;
+  }
+  
+  first = entry->first;
+  second = entry->second;
+  ++m_hits;
+  
+  return true;
+  
+}
+
+void PlotCache::Put(const std::string& key, const int version, const std::string& first, const std::string& second){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  
+  if(Find(key, version)) return; // versions are immutable, nothing to update
+  
+  Entry entry;
+  entry.id = Id(key, version);
+  entry.first = first;
+  entry.second = second;
+  m_lru.push_front(std::move(entry));
+  m_index[m_lru.front().id] = m_lru.begin();
+  m_bytes += first.size() + second.size();
+  
+  Evict();
+  
+}
+
+void PlotCache::Clear(){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  m_lru.clear();
+  m_index.clear();
+  m_bytes=0;
+  
+}
+
+unsigned long PlotCache::Hits(){
+  
+  return m_hits;
+  
+}
+
+unsigned long PlotCache::Misses(){
+  
+  return m_misses;
+  
+}
+
+size_t PlotCache::Bytes(){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_bytes;
+  
+}
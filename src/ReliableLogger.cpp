@@ -0,0 +1,256 @@
+#include <ReliableLogger.h>
+#include <JsonUtils.h>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  // ISO 8601 UTC with milliseconds, which postgres accepts for timestamp columns
+  std::string FormatTime(uint64_t ms_since_epoch){
+    
+    std::time_t seconds = ms_since_epoch/1000;
+    std::tm utc;
+    gmtime_r(&seconds, &utc);
+    char buf[40];
+    size_t len = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &utc);
+    snprintf(buf+len, sizeof(buf)-len, ".%03uZ", static_cast<unsigned int>(ms_since_epoch%1000));
+    
+    return buf;
+    
+  }
+  
+}
+
+ReliableLogger::ReliableLogger(std::function<bool(const std::vector<SQLRow>&, std::string&)> insert, const std::string& default_device, const size_t queue_size, const size_t batch_size, const std::string& spool_file, const unsigned int block_timeout_ms) : m_insert(insert), m_default_device(default_device), m_queue_size(queue_size ? queue_size : 1), m_batch_size(batch_size ? batch_size : 1), m_spool_file(spool_file), m_block_timeout_ms(block_timeout_ms), m_in_flight(0), m_written(0), m_spooled(0), m_retries(0), m_dropped(0){
+  
+  // pick up anything left in the spool by a previous run
+  std::ifstream existing(m_spool_file);
+  m_spool_pending = !m_spool_file.empty() && existing.good() && existing.peek()!=std::ifstream::traits_type::eof();
+  
+  m_running=true;
+  m_thread = std::thread(&ReliableLogger::Thread, this);
+  
+}
+
+ReliableLogger::~ReliableLogger(){
+  
+  Flush(m_block_timeout_ms);
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_running=false;
+  }
+  m_work_cv.notify_all();
+  m_thread.join();
+  
+  // the writer may have been backing off when we stopped it: one last try, batch by batch, without backoff
+  std::string error;
+  while(!m_queue.empty()){
+    size_t n = std::min(m_batch_size, m_queue.size());
+    std::vector<SQLRow> batch(m_queue.begin(), m_queue.begin()+n);
+    if(!m_insert(batch, error)) break;
+    m_queue.erase(m_queue.begin(), m_queue.begin()+n);
+    m_written+=n;
+  }
+  
+  // whatever still couldn't be written goes to the spool for the next run, and without one is reported lost
+  for(const SQLRow& row : m_queue){
+    if(!Spool(row)) ++m_dropped;
+  }
+  if(m_dropped) std::cerr<<"ReliableLogger: "<<m_dropped<<" log(s) could not be written or spooled and were lost"<<(error.empty() ? "" : ": "+error)<<std::endl;
+  
+}
+
+bool ReliableLogger::SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp){
+  
+  return SendLog(std::string(message), severity, device, timestamp);
+  
+}
+
+bool ReliableLogger::SendLog(std::string&& message, LogLevel severity, const std::string& device, const uint64_t timestamp){
+  
+  uint64_t time = timestamp ? timestamp : std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  SQLRow row{FormatTime(time), (device.empty() ? m_default_device : device), static_cast<int64_t>(severity), std::move(message)};
+  
+  std::unique_lock<std::mutex> lock(m_mtx);
+  
+  if(m_queue.size()>=m_queue_size){
+    if(!m_spool_file.empty()){
+      bool ok = Spool(row);
+      m_spool_pending = m_spool_pending || ok;
+      return ok;
+    }
+    // backpressure: hold the caller until the writer makes room
+    if(!m_space_cv.wait_for(lock, std::chrono::milliseconds(m_block_timeout_ms), [this]{ return m_queue.size()<m_queue_size; })) return false;
+  }
+  
+  m_queue.push_back(std::move(row));
+  if(m_queue.size()>=m_batch_size) m_work_cv.notify_one();
+  
+  return true;
+  
+}
+
+bool ReliableLogger::Flush(const unsigned int timeout_ms){
+  
+  std::unique_lock<std::mutex> lock(m_mtx);
+  m_work_cv.notify_one();
+  
+  return m_space_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this]{ return m_queue.empty() && m_in_flight==0 && !m_spool_pending; });
+  
+}
+
+void ReliableLogger::Thread(){
+  
+  unsigned int backoff_ms=0;
+  std::vector<SQLRow> batch;
+  std::string error;
+  std::unique_lock<std::mutex> lock(m_mtx);
+  
+  while(m_running){
+    
+    // wake for a full batch, a flush, or every 100ms for stragglers
+    if(m_queue.empty() && !m_spool_pending) m_work_cv.wait_for(lock, std::chrono::milliseconds(100));
+    if(backoff_ms) m_work_cv.wait_for(lock, std::chrono::milliseconds(backoff_ms), [this]{ return !m_running; });
+    if(!m_running) break;
+    
+    if(m_queue.empty()){
+      if(m_spool_pending){
+        lock.unlock();
+        bool ok = ReplaySpool();
+        lock.lock();
+        if(ok) m_spool_pending=false;
+        backoff_ms = ok ? 0 : std::min(10000u, std::max(100u, backoff_ms*2));
+        m_space_cv.notify_all();
+      }
+      continue;
+    }
+    
+    // rows stay at the front of the queue until acknowledged, so a failed batch is simply sent again
+    size_t n = std::min(m_batch_size, m_queue.size());
+    batch.assign(m_queue.begin(), m_queue.begin()+n);
+    m_in_flight=n;
+    lock.unlock();
+    
+    bool ok = m_insert(batch, error);
+    
+    lock.lock();
+    m_in_flight=0;
+    if(ok){
+      m_queue.erase(m_queue.begin(), m_queue.begin()+n);
+      m_written+=n;
+      backoff_ms=0;
+      m_space_cv.notify_all();
+    } else {
+      ++m_retries;
+      backoff_ms = std::min(10000u, std::max(100u, backoff_ms*2));
+    }
+    
+  }
+  
+}
+
+bool ReliableLogger::Spool(const SQLRow& row){
+  
+  if(m_spool_file.empty()) return false;
+  
+  std::ofstream spool(m_spool_file, std::ios::app);
+  if(!spool) return false;
+  spool<<JsonUtils::Quote(std::get<std::string>(row[0]))<<'\t'<<JsonUtils::Quote(std::get<std::string>(row[1]))<<'\t'
+       <<std::get<int64_t>(row[2])<<'\t'<<JsonUtils::Quote(std::get<std::string>(row[3]))<<'\n';
+  ++m_spooled;
+  
+  return spool.good();
+  
+}
+
+bool ReliableLogger::ReplaySpool(){
+  
+  // called from the writer thread without the lock; new spills append to the file meanwhile,
+  // so move it aside first and only delete it once everything in it has been written
+  std::string replay_file = m_spool_file+".replay";
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    std::ifstream pending(replay_file);
+    if(!pending.good() && std::rename(m_spool_file.c_str(), replay_file.c_str())!=0) return false;
+  }
+  
+  std::ifstream spool(replay_file);
+  std::vector<SQLRow> batch;
+  std::string line, error;
+  size_t skip=0;
+  std::ifstream progress(replay_file+".done");
+  progress>>skip; // rows already written by an earlier partial replay
+  size_t line_number=0;
+  
+  while(std::getline(spool, line)){
+    
+    if(line_number++<skip) continue;
+    std::vector<std::string> fields;
+    size_t start=0, tab;
+    while((tab=line.find('\t', start))!=std::string::npos){
+      fields.push_back(line.substr(start, tab-start));
+      start=tab+1;
+    }
+    fields.push_back(line.substr(start));
+    if(fields.size()!=4) continue;
+    
+    batch.push_back(SQLRow{JsonUtils::Unquote(fields[0]), JsonUtils::Unquote(fields[1]), static_cast<int64_t>(std::stoll(fields[2])), JsonUtils::Unquote(fields[3])});
+    
+    if(batch.size()>=m_batch_size){
+      if(!m_insert(batch, error)) return false;
+      m_written+=batch.size();
+      batch.clear();
+      std::ofstream(replay_file+".done")<<line_number;
+    }
+    
+  }
+  
+  if(!batch.empty()){
+    if(!m_insert(batch, error)) return false;
+    m_written+=batch.size();
+  }
+  
+  std::remove(replay_file.c_str());
+  std::remove((replay_file+".done").c_str());
+  
+  // more may have been spilled while we were replaying
+  std::ifstream remaining(m_spool_file);
+  return !(remaining.good() && remaining.peek()!=std::ifstream::traits_type::eof());
+  
+}
+
+size_t ReliableLogger::Queued(){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_queue.size();
+  
+}
+
+unsigned long ReliableLogger::Written(){
+  
+  return m_written;
+  
+}
+
+unsigned long ReliableLogger::Spooled(){
+  
+  return m_spooled;
+  
+}
+
+unsigned long ReliableLogger::Retries(){
+  
+  return m_retries;
+  
+}
+
+unsigned long ReliableLogger::Dropped(){
+  
+  return m_dropped;
+  
+}
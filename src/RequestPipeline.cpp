@@ -0,0 +1,113 @@
+#include <RequestPipeline.h>
+
+using namespace ToolFramework;
+
+RequestPipeline::RequestPipeline(const unsigned int window, SpanTracer* spans) : m_spans(spans){
+  
+  m_running=true;
+  m_in_flight=0;
+  m_expired=0;
+  for(unsigned int i=0; i<(window ? window : 1); ++i) m_workers.emplace_back(&RequestPipeline::Worker, this);
+  
+}
+
+RequestPipeline::~RequestPipeline(){
+  
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_running=false;
+  }
+  m_cv.notify_all();
+  for(std::thread& worker : m_workers) worker.join();
+  
+  // anything never sent fails
+  for(Request& request : m_queue) request.promise.set_value(false);
+  
+}
+
+std::future<bool> RequestPipeline::Submit(std::function<bool(const unsigned int timeout)> call, const unsigned int timeout){
+  
+  Request request;
+  request.call = std::move(call);
+  request.submitted = std::chrono::steady_clock::now();
+  request.deadline = request.submitted + std::chrono::milliseconds(timeout);
+  std::future<bool> result = request.promise.get_future();
+  
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if(!m_running){
+      request.promise.set_value(false);
+      return result;
+    }
+    m_queue.push_back(std::move(request));
+  }
+  m_cv.notify_one();
+  
+  return result;
+  
+}
+
+void RequestPipeline::Worker(){
+  
+  std::unique_lock<std::mutex> lock(m_mtx);
+  
+  while(true){
+    
+    m_cv.wait(lock, [this]{ return !m_running || !m_queue.empty(); });
+    if(!m_running) return;
+    
+    Request request = std::move(m_queue.front());
+    m_queue.pop_front();
+    
+    std::chrono::steady_clock::time_point picked = std::chrono::steady_clock::now();
+    std::chrono::milliseconds remaining = std::chrono::duration_cast<std::chrono::milliseconds>(request.deadline - picked);
+    if(remaining.count()<=0){
+      ++m_expired;
+      request.promise.set_value(false);
+      continue;
+    }
+    
+    ++m_in_flight;
+    lock.unlock();
+    
+    try{
+      SpanTracer::Scope span(m_spans, "request", "pipeline");
+      span.Waited(picked - request.submitted);
+      request.promise.set_value(span.Ok(request.call(remaining.count())));
+    } catch(...){
+      request.promise.set_exception(std::current_exception());
+    }
+    
+    lock.lock();
+    --m_in_flight;
+    
+  }
+  
+}
+
+unsigned int RequestPipeline::GetWindow(){
+  
+  return m_workers.size();
+  
+}
+
+size_t RequestPipeline::Queued(){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_queue.size();
+  
+}
+
+unsigned int RequestPipeline::InFlight(){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_in_flight;
+  
+}
+
+unsigned long RequestPipeline::Expired(){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_expired;
+  
+}
@@ -0,0 +1,133 @@
+#include <SQLInsertBuilder.h>
+#include <JsonUtils.h>
+#include <cmath>
+#include <cstdio>
+#include <cctype>
+#include <algorithm>
+
+using namespace ToolFramework;
+
+bool SQLInsertBuilder::ValidIdentifier(const std::string& name, const bool allow_schema){
+  
+  if(name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) return false;
+  
+  bool dotted=false;
+  for(size_t i=0; i<name.size(); ++i){
+    char c=name[i];
+    if(c=='.' && allow_schema && !dotted && i>0 && i+1<name.size() && !std::isdigit(static_cast<unsigned char>(name[i+1]))){
+      dotted=true;
+      continue;
+    }
+    if(!std::isalnum(static_cast<unsigned char>(c)) && c!='_') return false;
+  }
+  
+  return true;
+  
+}
+
+void SQLInsertBuilder::AppendValue(std::string& out, const SQLValue& value){
+  
+  switch(value.index()){
+  case 0:
+    out+="null";
+    break;
+  case 1:
+    out+= std::get<bool>(value) ? "true" : "false";
+    break;
+  case 2:
+    out+=std::to_string(std::get<int64_t>(value));
+    break;
+  case 3: {
+    double number = std::get<double>(value);
+    // JSON has no NaN/inf but postgres' float input accepts them as strings
+    if(std::isnan(number)) out+="\"NaN\"";
+    else if(std::isinf(number)) out+= number>0 ? "\"Infinity\"" : "\"-Infinity\"";
+    else {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%.17g", number);
+      out+=buf;
+    }
+    break;
+  }
+  case 4:
+    out+=JsonUtils::Quote(std::get<std::string>(value));
+    break;
+  }
+  
+}
+
+bool SQLInsertBuilder::BuildStatements(const std::string& table, const std::vector<std::string>& columns, const std::vector<SQLRow>& rows, std::vector<std::string>& statements, std::string& error, const unsigned int batch_size){
+  
+  statements.clear();
+  
+  if(!ValidIdentifier(table, true)){
+    error = "invalid table name '"+table+"'";
+    return false;
+  }
+  if(columns.empty()){
+    error = "no columns given";
+    return false;
+  }
+  
+  // identifiers are unquoted in the statement, so postgres folds them to lower case; the JSON keys must match
+  std::string column_list;
+  std::vector<std::string> keys;
+  for(const std::string& column : columns){
+    if(!ValidIdentifier(column)){
+      error = "invalid column name '"+column+"'";
+      return false;
+    }
+    if(!column_list.empty()) column_list+=", ";
+    column_list+=column;
+    std::string key=column;
+    for(char& c : key) c = std::tolower(static_cast<unsigned char>(c));
+    keys.push_back(JsonUtils::Quote(key)+":");
+  }
+  
+  for(size_t i=0; i<rows.size(); ++i){
+    if(rows[i].size()!=columns.size()){
+      error = "row "+std::to_string(i)+" has "+std::to_string(rows[i].size())+" values for "+std::to_string(columns.size())+" columns";
+      return false;
+    }
+  }
+  
+  const std::string head = "INSERT INTO "+table+" ( "+column_list+" ) SELECT "+column_list+" FROM json_populate_recordset(NULL::"+table+", '";
+  const std::string tail = "')";
+  const size_t step = batch_size ? batch_size : rows.size();
+  
+  for(size_t first=0; first<rows.size(); first+=step){
+    
+    size_t last = std::min(rows.size(), first+step);
+    std::string json;
+    json.reserve((last-first)*columns.size()*16);
+    json+='[';
+    
+    for(size_t r=first; r<last; ++r){
+      if(r!=first) json+=',';
+      json+='{';
+      for(size_t c=0; c<columns.size(); ++c){
+        if(c) json+=',';
+        json+=keys[c];
+        AppendValue(json, rows[r][c]);
+      }
+      json+='}';
+    }
+    json+=']';
+    
+    // embed as a standard-conforming SQL string literal
+    std::string statement;
+    statement.reserve(head.size()+json.size()+tail.size()+16);
+    statement+=head;
+    for(char c : json){
+      if(c=='\'') statement+='\'';
+      statement+=c;
+    }
+    statement+=tail;
+    
+    statements.push_back(std::move(statement));
+    
+  }
+  
+  return true;
+  
+}
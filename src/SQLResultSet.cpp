@@ -0,0 +1,416 @@
+#include <SQLResultSet.h>
+#include <JsonUtils.h>
+#include <cstdlib>
+#include <cerrno>
+#include <charconv>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  // days since 1970-01-01 for a proleptic gregorian date
+  int64_t DaysFromCivil(int64_t y, unsigned int m, unsigned int d){
+    
+    y -= m<=2;
+    const int64_t era = (y>=0 ? y : y-399) / 400;
+    const unsigned int yoe = static_cast<unsigned int>(y - era*400);
+    const unsigned int doy = (153*(m>2 ? m-3 : m+9) + 2)/5 + d-1;
+    const unsigned int doe = yoe*365 + yoe/4 - yoe/100 + doy;
+    
+    return era*146097 + static_cast<int64_t>(doe) - 719468;
+    
+  }
+  
+  bool ReadDigits(std::string_view in, size_t& pos, size_t count, int& out){
+    
+    out=0;
+    for(size_t i=0; i<count; ++i, ++pos){
+      if(pos>=in.size() || in[pos]<'0' || in[pos]>'9') return false;
+      out = out*10 + (in[pos]-'0');
+    }
+    
+    return true;
+    
+  }
+  
+  // accepts the formats postgres emits in JSON: YYYY-MM-DD, YYYY-MM-DD[T ]HH:MM:SS[.ffffff][Z|+HH[:MM]|-HH[:MM]]
+  bool ParseTimestamp(std::string_view in, int64_t& microseconds){
+    
+    size_t pos=0;
+    int year, month, day;
+    if(!ReadDigits(in, pos, 4, year) || pos>=in.size() || in[pos++]!='-' ||
+       !ReadDigits(in, pos, 2, month) || pos>=in.size() || in[pos++]!='-' ||
+       !ReadDigits(in, pos, 2, day)) return false;
+    if(month<1 || month>12 || day<1 || day>31) return false;
+    
+    int64_t seconds = DaysFromCivil(year, month, day)*86400;
+    int64_t fraction = 0;
+    
+    if(pos<in.size()){
+      if(in[pos]!='T' && in[pos]!=' ') return false;
+      ++pos;
+      int hour, minute, second;
+      if(!ReadDigits(in, pos, 2, hour) || pos>=in.size() || in[pos++]!=':' ||
+         !ReadDigits(in, pos, 2, minute) || pos>=in.size() || in[pos++]!=':' ||
+         !ReadDigits(in, pos, 2, second)) return false;
+      seconds += hour*3600 + minute*60 + second;
+      
+      if(pos<in.size() && in[pos]=='.'){
+        ++pos;
+        int64_t scale=100000;
+        while(pos<in.size() && in[pos]>='0' && in[pos]<='9'){
+          fraction += (in[pos++]-'0')*scale;
+          scale/=10;
+        }
+      }
+      
+      if(pos<in.size()){
+        if(in[pos]=='Z') ++pos;
+        else if(in[pos]=='+' || in[pos]=='-'){
+          int sign = (in[pos++]=='+') ? 1 : -1;
+          int offset_hours, offset_minutes=0;
+          if(!ReadDigits(in, pos, 2, offset_hours)) return false;
+          if(pos<in.size() && in[pos]==':') ++pos;
+          if(pos<in.size() && !ReadDigits(in, pos, 2, offset_minutes)) return false;
+          seconds -= sign*(offset_hours*3600 + offset_minutes*60);
+        }
+        else return false;
+      }
+    }
+    
+    if(pos!=in.size()) return false;
+    microseconds = seconds*1000000 + fraction;
+    
+    return true;
+    
+  }
+  
+  bool IsInteger(std::string_view in, int64_t& value){
+    
+    // from_chars takes no leading '+' or whitespace, as JSON has none; out of range fails rather than wrapping
+    std::from_chars_result result = std::from_chars(in.data(), in.data()+in.size(), value);
+    
+    return result.ec==std::errc() && result.ptr==in.data()+in.size();
+    
+  }
+  
+  bool IsNumber(std::string_view in){
+    
+    if(in.empty() || (in[0]!='-' && (in[0]<'0' || in[0]>'9'))) return false;
+    std::string text{in};
+    char* end=nullptr;
+    std::strtod(text.c_str(), &end);
+    
+    return end==text.c_str()+text.size();
+    
+  }
+  
+  // the type of an undeclared cell, from its JSON kind only: what kind of number, or whether some text is
+  // a date, would otherwise change with the values a particular query happened to return
+  SQLColumnType CellType(std::string_view cell){
+    
+    if(cell=="null") return SQLColumnType::Null;
+    if(cell=="true" || cell=="false") return SQLColumnType::Bool;
+    if(IsNumber(cell)) return SQLColumnType::Float;
+    
+    return SQLColumnType::String;
+    
+  }
+  
+  bool Fits(SQLColumnType type, std::string_view cell){
+    
+    int64_t unused;
+    switch(type){
+    case SQLColumnType::Bool:
+      return cell=="true" || cell=="false";
+    case SQLColumnType::Int:
+      return IsInteger(cell, unused);
+    case SQLColumnType::Float:
+      return IsNumber(cell);
+    case SQLColumnType::Timestamp:
+      return cell.size()>=2 && cell.front()=='"' && cell.find('\\')==std::string_view::npos && ParseTimestamp(cell.substr(1, cell.size()-2), unused);
+    default:
+      return true;
+    }
+    
+  }
+  
+  const char* TypeName(SQLColumnType type){
+    
+    switch(type){
+    case SQLColumnType::Bool: return "bool";
+    case SQLColumnType::Int: return "int";
+    case SQLColumnType::Float: return "float";
+    case SQLColumnType::Timestamp: return "timestamp";
+    case SQLColumnType::String: return "string";
+    default: return "null";
+    }
+    
+  }
+  
+  SQLColumnType Promote(SQLColumnType current, SQLColumnType cell){
+    
+    if(cell==SQLColumnType::Null || cell==current) return current;
+    if(current==SQLColumnType::Null) return cell;
+    
+    return SQLColumnType::String;
+    
+  }
+  
+}
+
+SQLResultSet::SQLResultSet(){
+  
+  Clear();
+  
+}
+
+std::string SQLResultSet::WrapQuery(const std::string& query){
+  
+  std::string_view inner = JsonUtils::Trim(query);
+  while(!inner.empty() && inner.back()==';') inner = JsonUtils::Trim(inner.substr(0, inner.size()-1));
+  
+  // json_each over a json (not jsonb) row keeps the column order of the query; the rows are numbered as
+  // they come out of q, since json_agg alone doesn't promise to keep an ORDER BY inside it
+  return "WITH q AS ( " + std::string{inner} + " ) SELECT json_build_object("
+    "'columns', (SELECT json_agg(key) FROM json_each((SELECT row_to_json(q) FROM q LIMIT 1))), "
+    "'rows', (SELECT json_agg((SELECT json_agg(value) FROM json_each(r.j)) ORDER BY r.n) FROM (SELECT row_to_json(q) AS j, row_number() OVER () AS n FROM q) r)"
+    ") AS result";
+  
+}
+
+bool SQLResultSet::Decode(const std::string& response){
+  
+  Clear();
+  
+  std::vector<std::pair<std::string, std::string_view> > members;
+  if(!JsonUtils::SplitObject(response, members)){
+    m_error = "malformed response: " + response;
+    return false;
+  }
+  
+  std::string_view columns, rows;
+  for(const std::pair<std::string, std::string_view>& member : members){
+    if(member.first=="columns") columns = member.second;
+    else if(member.first=="rows") rows = member.second;
+  }
+  if(!columns.empty() || !rows.empty()) return DecodeTable(columns, rows);
+  
+  // otherwise we got the row holding our wrapped result: {"result":{...}}, possibly string-encoded
+  if(members.size()==1){
+    if(JsonUtils::IsString(members.front().second)) return Decode(JsonUtils::Unquote(members.front().second));
+    return Decode(std::string{members.front().second});
+  }
+  
+  m_error = "unexpected response: " + response;
+  
+  return false;
+  
+}
+
+bool SQLResultSet::DecodeTable(std::string_view columns, std::string_view rows){
+  
+  // an empty result gives null columns and rows
+  if(columns.empty() || JsonUtils::IsNull(columns)) return true;
+  
+  std::vector<std::string_view> names;
+  if(!JsonUtils::SplitArray(columns, names)){
+    m_error = "malformed column list";
+    return false;
+  }
+  
+  std::vector<std::string_view> row_list;
+  if(!rows.empty() && !JsonUtils::IsNull(rows) && !JsonUtils::SplitArray(rows, row_list)){
+    m_error = "malformed row list";
+    return false;
+  }
+  
+  // split every row once, keeping views into the response; check declared column types, infer the rest
+  m_columns.resize(names.size());
+  std::vector<bool> declared(names.size(), false);
+  for(size_t i=0; i<names.size(); ++i){
+    m_columns[i].name = JsonUtils::Unquote(names[i]);
+    m_columns[i].type = SQLColumnType::Null;
+    std::map<std::string, SQLColumnType>::const_iterator it = m_declared.find(m_columns[i].name);
+    if(it!=m_declared.end() && it->second!=SQLColumnType::Null){
+      m_columns[i].type = it->second;
+      declared[i] = true;
+    }
+  }
+  
+  std::vector<std::string_view> cells(row_list.size()*names.size());
+  std::vector<std::string_view> row;
+  for(size_t r=0; r<row_list.size(); ++r){
+    if(!JsonUtils::SplitArray(row_list[r], row) || row.size()!=names.size()){
+      Clear();
+      m_error = "malformed row " + std::to_string(r);
+      return false;
+    }
+    for(size_t c=0; c<row.size(); ++c){
+      std::string_view cell = JsonUtils::Trim(row[c]);
+      cells[r*names.size()+c] = cell;
+      if(!declared[c]) m_columns[c].type = Promote(m_columns[c].type, CellType(cell));
+      else if(cell!="null" && !Fits(m_columns[c].type, cell)){
+        std::string error = "row " + std::to_string(r) + " column '" + m_columns[c].name + "': " + std::string{cell} + " is not a " + TypeName(m_columns[c].type);
+        Clear();
+        m_error = error;
+        return false;
+      }
+    }
+  }
+  
+  // fill the typed buffers
+  m_rows = row_list.size();
+  for(size_t c=0; c<m_columns.size(); ++c){
+    
+    Column& column = m_columns[c];
+    column.nulls.resize(m_rows);
+    switch(column.type){
+    case SQLColumnType::Bool:
+    case SQLColumnType::Int:
+    case SQLColumnType::Timestamp:
+      column.ints.resize(m_rows); break;
+    case SQLColumnType::Float:
+      column.floats.resize(m_rows); break;
+    case SQLColumnType::String:
+      column.strings.resize(m_rows); break;
+    case SQLColumnType::Null: // all null: every accessor reads 0 / "" for every row
+      column.ints.resize(m_rows);
+      column.floats.resize(m_rows);
+      column.strings.resize(m_rows);
+      break;
+    }
+    
+    for(size_t r=0; r<m_rows; ++r){
+      
+      std::string_view cell = cells[r*names.size()+c];
+      if(cell=="null"){
+        column.nulls[r] = true;
+        continue;
+      }
+      
+      switch(column.type){
+      case SQLColumnType::Bool:
+        column.ints[r] = (cell=="true");
+        break;
+      case SQLColumnType::Int:
+        IsInteger(cell, column.ints[r]);
+        break;
+      case SQLColumnType::Timestamp:
+        ParseTimestamp(cell.substr(1, cell.size()-2), column.ints[r]);
+        break;
+      case SQLColumnType::Float:
+        column.floats[r] = std::strtod(std::string{cell}.c_str(), nullptr);
+        break;
+      case SQLColumnType::String:
+        column.strings[r] = JsonUtils::IsString(cell) ? JsonUtils::Unquote(cell) : std::string{cell};
+        break;
+      case SQLColumnType::Null:
+        break;
+      }
+      
+    }
+    
+  }
+  
+  return true;
+  
+}
+
+void SQLResultSet::Declare(const std::string& column, const SQLColumnType type){
+  
+  m_declared[column] = type;
+  
+}
+
+void SQLResultSet::ClearDeclarations(){
+  
+  m_declared.clear();
+  
+}
+
+void SQLResultSet::Clear(){
+  
+  m_columns.clear();
+  m_rows=0;
+  m_error.clear();
+  
+}
+
+size_t SQLResultSet::Rows() const{
+  
+  return m_rows;
+  
+}
+
+size_t SQLResultSet::Columns() const{
+  
+  return m_columns.size();
+  
+}
+
+std::vector<std::string> SQLResultSet::ColumnNames() const{
+  
+  std::vector<std::string> names;
+  names.reserve(m_columns.size());
+  for(const Column& column : m_columns) names.push_back(column.name);
+  
+  return names;
+  
+}
+
+int SQLResultSet::ColumnIndex(const std::string& name) const{
+  
+  for(size_t i=0; i<m_columns.size(); ++i) if(m_columns[i].name==name) return i;
+  
+  return -1;
+  
+}
+
+const std::string& SQLResultSet::ColumnName(const size_t column) const{
+  
+  return m_columns.at(column).name;
+  
+}
+
+SQLColumnType SQLResultSet::ColumnType(const size_t column) const{
+  
+  return m_columns.at(column).type;
+  
+}
+
+bool SQLResultSet::IsNull(const size_t row, const size_t column) const{
+  
+  return m_columns.at(column).nulls.at(row);
+  
+}
+
+const std::vector<int64_t>& SQLResultSet::Ints(const size_t column) const{
+  
+  return m_columns.at(column).ints;
+  
+}
+
+const std::vector<double>& SQLResultSet::Floats(const size_t column) const{
+  
+  return m_columns.at(column).floats;
+  
+}
+
+const std::vector<std::string>& SQLResultSet::Strings(const size_t column) const{
+  
+  return m_columns.at(column).strings;
+  
+}
+
+const std::string& SQLResultSet::Error() const{
+  
+  return m_error;
+  
+}
+
+void SQLResultSet::SetError(const std::string& error){
+  
+  m_error = error;
+  
+}
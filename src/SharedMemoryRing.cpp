@@ -0,0 +1,602 @@
+#include <SharedMemoryRing.h>
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  const uint32_t ring_magic = 0x44414952; // "DAIR"
+  const uint32_t ring_version = 2;
+  const unsigned int reclaim_grace_ms = 1000; // how long a slot must sit stuck before its client is judged
+  
+  enum SlotState : uint32_t { Idle=0, Waiting, Replied, Abandoned, Reading };
+  
+  // brief spin, then progressively longer sleeps, up to 1ms
+  void Backoff(unsigned int& attempt){
+    
+    if(attempt<64) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::microseconds(std::min(1000u, 10u<<std::min(attempt-64, 7u))));
+    ++attempt;
+    
+  }
+  
+  // the same clock in every process on the node
+  uint64_t MonotonicMs(){
+    
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    
+  }
+  
+  bool Dead(const int32_t pid){
+    
+    return pid>0 && kill(pid, 0)!=0 && errno==ESRCH;
+    
+  }
+  
+  bool WriteSpill(const std::string& name, const std::string& data){
+    
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+    if(fd<0) return false;
+    void* segment = (ftruncate(fd, data.size())==0) ? mmap(nullptr, data.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if(segment==MAP_FAILED){
+      shm_unlink(name.c_str());
+      return false;
+    }
+    memcpy(segment, data.data(), data.size());
+    munmap(segment, data.size());
+    
+    return true;
+    
+  }
+  
+  // a spill is read once, so it's unlinked as soon as it's opened
+  bool ReadSpill(const std::string& name, const size_t length, std::string& data){
+    
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if(fd<0) return false;
+    shm_unlink(name.c_str());
+    struct stat info;
+    void* segment = (fstat(fd, &info)==0 && size_t(info.st_size)>=length) ? mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if(segment==MAP_FAILED) return false;
+    data.assign(static_cast<const char*>(segment), length);
+    munmap(segment, length);
+    
+    return true;
+    
+  }
+  
+}
+
+struct SharedMemoryRing::Header{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slots;
+  uint32_t slot_size;
+  uint64_t generation; // tells an agent's segment from its predecessor's under the same name
+  std::atomic<uint32_t> closed; // set by the agent on a clean shutdown
+  alignas(64) std::atomic<uint64_t> enqueue_pos;
+  alignas(64) std::atomic<uint64_t> dequeue_pos;
+};
+
+struct SharedMemoryRing::Slot{
+  std::atomic<uint64_t> sequence;
+  std::atomic<uint32_t> state;
+  uint32_t type;
+  uint32_t length;
+  uint32_t ok;
+  uint32_t spilled; // the payload or reply is in a spill segment, not in the slot
+  int32_t owner; // pid of the client that claimed the slot
+  uint64_t deadline_ms; // MonotonicMs() until which the client may hold the slot
+  std::atomic<uint64_t> claimed; // position+1 once owner and deadline_ms are set for it
+  uint64_t position;
+  // followed by slot_size bytes of payload/reply
+  char* Data(){ return reinterpret_cast<char*>(this+1); }
+};
+
+struct SharedMemoryRing::Mapping{
+  void* segment;
+  size_t size;
+  Header* header;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free, "shared memory ring needs address-free atomics");
+
+SharedMemoryRing::SharedMemoryRing() : m_owner(false), m_mapping(nullptr), m_stalled_position(UINT64_MAX), m_reclaimed(0){}
+
+SharedMemoryRing::~SharedMemoryRing(){
+  
+  Close();
+  
+}
+
+bool SharedMemoryRing::Create(const std::string& name, const uint32_t slots, const uint32_t slot_size){
+  
+  Close();
+  if(slots==0 || slot_size==0) return false;
+  
+  uint32_t stride = ((sizeof(Slot)+slot_size+63)/64)*64;
+  size_t size = ((sizeof(Header)+63)/64)*64 + size_t(slots)*stride;
+  
+  // a predecessor that died without closing its segment leaves its clients on it; marking it closed moves them over
+  Mapping* previous = Map(name);
+  if(previous){
+    previous->header->closed.store(1, std::memory_order_release);
+    Unmap(previous);
+  }
+  
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+  if(fd<0) return false;
+  if(ftruncate(fd, size)!=0){
+    close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+  void* segment = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(segment==MAP_FAILED){
+    shm_unlink(name.c_str());
+    return false;
+  }
+  
+  Mapping* map = new Mapping{segment, size, new (segment) Header};
+  Header* header = map->header;
+  header->slots=slots;
+  header->slot_size=slot_size;
+  header->generation = std::chrono::system_clock::now().time_since_epoch().count() ^ (uint64_t(getpid())<<48);
+  header->closed.store(0);
+  header->enqueue_pos.store(0);
+  header->dequeue_pos.store(0);
+  
+  m_name=name;
+  m_owner=true;
+  m_stalled_position=UINT64_MAX;
+  m_mapping.store(map, std::memory_order_release);
+  for(uint32_t i=0; i<slots; ++i){
+    Slot* slot = new (GetSlot(map, i)) Slot;
+    slot->sequence.store(i);
+    slot->state.store(Idle);
+    slot->claimed.store(0);
+  }
+  
+  // publish last, clients check it on open
+  header->version=ring_version;
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic=ring_magic;
+  
+  return true;
+  
+}
+
+bool SharedMemoryRing::Open(const std::string& name){
+  
+  Close();
+  
+  Mapping* map = Map(name);
+  if(!map) return false;
+  
+  m_name=name;
+  m_owner=false;
+  m_mapping.store(map, std::memory_order_release);
+  
+  return true;
+  
+}
+
+void SharedMemoryRing::Close(){
+  
+  Mapping* map = m_mapping.exchange(nullptr);
+  if(map){
+    if(m_owner){
+      map->header->closed.store(1, std::memory_order_release);
+      Mapping* named = Map(m_name); // only unlink the name if a successor hasn't taken it over
+      if(named && named->header->generation==map->header->generation) shm_unlink(m_name.c_str());
+      if(named) Unmap(named);
+      // messages and replies nobody will read now
+      Header* header = map->header;
+      for(uint64_t position=header->dequeue_pos.load(); position<header->enqueue_pos.load(); ++position){
+        Slot* slot = GetSlot(map, position);
+        if(slot->sequence.load(std::memory_order_acquire)==position+1 && slot->spilled) shm_unlink(SpillName(map, position, "request").c_str());
+      }
+      std::lock_guard<std::mutex> lock(m_replied_mtx);
+      for(const Uncollected& replied : m_replied){
+        if(replied.slot->spilled) shm_unlink(SpillName(map, replied.position, "reply").c_str());
+      }
+      m_replied.clear();
+    }
+    Unmap(map);
+  }
+  
+  std::lock_guard<std::mutex> lock(m_remap_mtx);
+  for(Mapping* retired : m_retired) Unmap(retired);
+  m_retired.clear();
+  m_owner=false;
+  
+}
+
+uint32_t SharedMemoryRing::SlotSize(){
+  
+  Mapping* map = m_mapping.load(std::memory_order_acquire);
+  return map ? map->header->slot_size : 0;
+  
+}
+
+uint64_t SharedMemoryRing::Generation(){
+  
+  Mapping* map = m_mapping.load(std::memory_order_acquire);
+  return map ? map->header->generation : 0;
+  
+}
+
+unsigned long SharedMemoryRing::Reclaimed(){
+  
+  return m_reclaimed;
+  
+}
+
+SharedMemoryRing::Mapping* SharedMemoryRing::Map(const std::string& name){
+  
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if(fd<0) return nullptr;
+  struct stat info;
+  if(fstat(fd, &info)!=0 || size_t(info.st_size)<sizeof(Header)){
+    close(fd);
+    return nullptr;
+  }
+  void* segment = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(segment==MAP_FAILED) return nullptr;
+  
+  Header* header = static_cast<Header*>(segment);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(header->magic!=ring_magic || header->version!=ring_version){
+    munmap(segment, info.st_size);
+    return nullptr;
+  }
+  
+  return new Mapping{segment, size_t(info.st_size), header};
+  
+}
+
+void SharedMemoryRing::Unmap(Mapping* map){
+  
+  munmap(map->segment, map->size);
+  delete map;
+  
+}
+
+SharedMemoryRing::Mapping* SharedMemoryRing::Current(){
+  
+  Mapping* map = m_mapping.load(std::memory_order_acquire);
+  if(!map || m_owner || !map->header->closed.load(std::memory_order_acquire)) return map;
+  
+  // the agent has shut down: use its successor if there is one yet
+  return Refresh(map) ? m_mapping.load(std::memory_order_acquire) : nullptr;
+  
+}
+
+bool SharedMemoryRing::Refresh(Mapping* stale){
+  
+  if(m_owner) return false;
+  
+  std::lock_guard<std::mutex> lock(m_remap_mtx);
+  if(m_mapping.load(std::memory_order_acquire)!=stale) return true; // another thread got there first
+  
+  Mapping* fresh = Map(m_name);
+  if(!fresh) return false;
+  if(fresh->header->generation==stale->header->generation){
+    Unmap(fresh);
+    return false;
+  }
+  
+  m_retired.push_back(stale);
+  m_mapping.store(fresh, std::memory_order_release);
+  
+  return true;
+  
+}
+
+std::string SharedMemoryRing::SpillName(Mapping* map, const uint64_t position, const char* kind){
+  
+  return m_name+"_"+std::to_string(map->header->generation)+"_"+std::to_string(position)+"_"+kind;
+  
+}
+
+SharedMemoryRing::Slot* SharedMemoryRing::GetSlot(Mapping* map, uint64_t position){
+  
+  uint32_t stride = ((sizeof(Slot)+map->header->slot_size+63)/64)*64;
+  char* first = static_cast<char*>(map->segment) + ((sizeof(Header)+63)/64)*64;
+  
+  return reinterpret_cast<Slot*>(first + (position % map->header->slots)*stride);
+  
+}
+
+SharedMemoryRing::Slot* SharedMemoryRing::Claim(Mapping* map, uint64_t& position, const unsigned int timeout_ms, const unsigned int hold_ms){
+  
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  unsigned int attempt=0;
+  Header* header = map->header;
+  position = header->enqueue_pos.load(std::memory_order_relaxed);
+  
+  while(true){
+    Slot* slot = GetSlot(map, position);
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+    if(diff==0){
+      if(header->enqueue_pos.compare_exchange_weak(position, position+1, std::memory_order_relaxed)){
+        // tag the claim first, so the agent can tell whose it is if we never publish
+        slot->owner = getpid();
+        slot->deadline_ms = MonotonicMs() + hold_ms;
+        slot->claimed.store(position+1, std::memory_order_release);
+        return slot;
+      }
+    }
+    else if(diff<0){
+      // full
+      if(std::chrono::steady_clock::now()>=deadline) return nullptr;
+      Backoff(attempt);
+      position = header->enqueue_pos.load(std::memory_order_relaxed);
+    }
+    else position = header->enqueue_pos.load(std::memory_order_relaxed);
+  }
+  
+}
+
+bool SharedMemoryRing::Write(Mapping* map, Slot* slot, const uint64_t position, const std::string& data, const char* kind){
+  
+  slot->position = position;
+  slot->length = data.size();
+  slot->spilled = data.size()>map->header->slot_size;
+  if(!slot->spilled) memcpy(slot->Data(), data.data(), data.size());
+  else if(!WriteSpill(SpillName(map, position, kind), data)){
+    slot->length = 0;
+    slot->spilled = 0;
+    return false;
+  }
+  
+  return true;
+  
+}
+
+bool SharedMemoryRing::Publish(Mapping* map, Slot* slot, const uint64_t position){
+  
+  // the agent may have given up on us and skipped the slot, in which case it's no longer ours to publish
+  uint64_t expected = position;
+  if(slot->sequence.compare_exchange_strong(expected, position+1, std::memory_order_release, std::memory_order_relaxed)) return true;
+  if(slot->spilled) shm_unlink(SpillName(map, position, "request").c_str());
+  
+  return false;
+  
+}
+
+void SharedMemoryRing::Release(Mapping* map, Slot* slot){
+  
+  slot->state.store(Idle, std::memory_order_relaxed);
+  slot->sequence.store(slot->position + map->header->slots, std::memory_order_release);
+  
+}
+
+bool SharedMemoryRing::Send(AgentMessageType type, const std::string& payload, const unsigned int timeout_ms){
+  
+  Mapping* map = Current();
+  if(!map) return false;
+  
+  uint64_t position;
+  Slot* slot = Claim(map, position, timeout_ms, reclaim_grace_ms);
+  if(!slot){
+    Refresh(map); // a ring that stays full may have lost its agent
+    return false;
+  }
+  
+  slot->type = static_cast<uint32_t>(type);
+  slot->state.store(Idle, std::memory_order_relaxed);
+  bool written = Write(map, slot, position, payload, "request"); // an empty message is discarded by the agent
+  
+  return Publish(map, slot, position) && written;
+  
+}
+
+bool SharedMemoryRing::Request(const std::string& payload, std::string& reply, const unsigned int timeout_ms){
+  
+  Mapping* map = Current();
+  if(!map){
+    reply = "agent ring closed";
+    return false;
+  }
+  
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  uint64_t position;
+  Slot* slot = Claim(map, position, timeout_ms, timeout_ms);
+  if(!slot){
+    reply = Refresh(map) ? "agent restarted" : "agent ring full";
+    return false;
+  }
+  
+  slot->state.store(Waiting, std::memory_order_relaxed);
+  if(!Write(map, slot, position, payload, "request")){
+    slot->type = static_cast<uint32_t>(AgentMessageType::Log); // still publish, so the ring moves on
+    Publish(map, slot, position);
+    reply = "could not write spill segment for request";
+    return false;
+  }
+  slot->type = static_cast<uint32_t>(AgentMessageType::Request);
+  if(!Publish(map, slot, position)){
+    reply = "agent reclaimed the slot before the request was sent";
+    return false;
+  }
+  
+  unsigned int attempt=0;
+  while(true){
+    uint32_t expected = slot->state.load(std::memory_order_acquire);
+    if(expected==Replied){
+      if(slot->state.compare_exchange_strong(expected, Reading, std::memory_order_acq_rel)) break;
+      reply = "reply reclaimed by agent";
+      return false;
+    }
+    if(std::chrono::steady_clock::now()>=deadline){
+      expected=Waiting;
+      if(slot->state.compare_exchange_strong(expected, SlotState::Abandoned, std::memory_order_acq_rel)){
+        reply = Refresh(map) ? "agent restarted" : "timed out waiting for agent";
+        return false; // the agent releases the slot when it's done
+      }
+      if(expected==Replied) continue; // the reply landed just now
+      reply = "reply reclaimed by agent";
+      return false;
+    }
+    Backoff(attempt);
+  }
+  
+  bool ok = slot->ok;
+  if(!slot->spilled) reply.assign(slot->Data(), slot->length);
+  else if(!ReadSpill(SpillName(map, position, "reply"), slot->length, reply)){
+    reply = "could not read spill segment for reply";
+    ok = false;
+  }
+  Release(map, slot);
+  
+  return ok;
+  
+}
+
+bool SharedMemoryRing::Receive(AgentMessageType& type, std::string& payload, Slot*& request, const unsigned int timeout_ms){
+  
+  request=nullptr;
+  Mapping* map = m_mapping.load(std::memory_order_acquire);
+  if(!map) return false;
+  Header* header = map->header;
+  
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  unsigned int attempt=0;
+  uint64_t position = header->dequeue_pos.load(std::memory_order_relaxed);
+  Slot* slot;
+  
+  while(true){
+    slot = GetSlot(map, position);
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(position+1);
+    if(diff==0){
+      if(header->dequeue_pos.compare_exchange_weak(position, position+1, std::memory_order_relaxed)){
+        if(slot->length || slot->type==static_cast<uint32_t>(AgentMessageType::Request)) break;
+        Release(map, slot); // a client that couldn't write its message
+        position = header->dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    else if(diff<0){
+      // empty
+      if(std::chrono::steady_clock::now()>=deadline) return false;
+      Backoff(attempt);
+      position = header->dequeue_pos.load(std::memory_order_relaxed);
+    }
+    else position = header->dequeue_pos.load(std::memory_order_relaxed);
+  }
+  
+  type = static_cast<AgentMessageType>(slot->type);
+  if(!slot->spilled) payload.assign(slot->Data(), std::min(slot->length, header->slot_size));
+  else if(!ReadSpill(SpillName(map, position, "request"), slot->length, payload)) payload.clear();
+  
+  if(type==AgentMessageType::Request) request=slot;
+  else Release(map, slot);
+  
+  return true;
+  
+}
+
+bool SharedMemoryRing::Abandoned(Slot* request){
+  
+  return request && request->state.load(std::memory_order_acquire)==SlotState::Abandoned;
+  
+}
+
+bool SharedMemoryRing::Reply(Slot* request, const bool ok, const std::string& reply){
+  
+  Mapping* map = m_mapping.load(std::memory_order_acquire);
+  if(!request || !map) return false;
+  
+  // a reply that can't be delivered whole is reported as a failure rather than silently truncated
+  if(Write(map, request, request->position, reply, "reply")) request->ok = ok;
+  else {
+    const std::string error = "reply too large for agent ring";
+    Write(map, request, request->position, error, "reply");
+    request->ok = false;
+  }
+  
+  uint32_t expected=Waiting;
+  if(!request->state.compare_exchange_strong(expected, Replied, std::memory_order_acq_rel)){
+    if(request->spilled) shm_unlink(SpillName(map, request->position, "reply").c_str());
+    Release(map, request); // client gave up
+    return false;
+  }
+  
+  std::lock_guard<std::mutex> lock(m_replied_mtx);
+  m_replied.push_back(Uncollected{request, request->position, std::chrono::steady_clock::now()});
+  
+  return true;
+  
+}
+
+unsigned int SharedMemoryRing::Reclaim(){
+  
+  Mapping* map = m_mapping.load(std::memory_order_acquire);
+  if(!map || !m_owner) return 0;
+  Header* header = map->header;
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::chrono::milliseconds grace(reclaim_grace_ms);
+  unsigned int reclaimed=0;
+  
+  // a slot claimed but never published holds up everything behind it
+  uint64_t position = header->dequeue_pos.load(std::memory_order_relaxed);
+  Slot* slot = GetSlot(map, position);
+  if(header->enqueue_pos.load(std::memory_order_relaxed)>position && slot->sequence.load(std::memory_order_acquire)==position){
+    if(position!=m_stalled_position){
+      m_stalled_position = position;
+      m_stalled_since = now;
+    }
+    else if(now-m_stalled_since>=grace){
+      // untagged after the grace period means the client died between claiming and tagging.
+      // a client that was only stopped for that long may still write into the slot when it resumes; its publish then fails
+      bool tagged = slot->claimed.load(std::memory_order_acquire)==position+1;
+      uint64_t expected = position;
+      if((!tagged || Dead(slot->owner) || MonotonicMs()>slot->deadline_ms) &&
+         slot->sequence.compare_exchange_strong(expected, position+header->slots, std::memory_order_acq_rel)){
+        header->dequeue_pos.compare_exchange_strong(position, position+1, std::memory_order_relaxed);
+        shm_unlink(SpillName(map, position, "request").c_str()); // in case it got that far
+        ++reclaimed;
+      }
+    }
+  }
+  
+  // replies never collected keep their slots from being reused
+  std::lock_guard<std::mutex> lock(m_replied_mtx);
+  for(size_t i=0; i<m_replied.size();){
+    Uncollected& replied = m_replied[i];
+    uint32_t expected=Replied;
+    bool waiting = replied.slot->position==replied.position && replied.slot->state.load(std::memory_order_acquire)==Replied;
+    if(waiting && (now-replied.since<grace || (!Dead(replied.slot->owner) && MonotonicMs()<=replied.slot->deadline_ms))){
+      ++i;
+      continue;
+    }
+    // no Receive can run between these checks and the exchange, so a Replied slot at this position is still this reply
+    if(waiting && replied.slot->state.compare_exchange_strong(expected, Reading, std::memory_order_acq_rel)){
+      if(replied.slot->spilled) shm_unlink(SpillName(map, replied.position, "reply").c_str());
+      Release(map, replied.slot);
+      ++reclaimed;
+    }
+    replied = m_replied.back();
+    m_replied.pop_back();
+  }
+  
+  m_reclaimed += reclaimed;
+  
+  return reclaimed;
+  
+}
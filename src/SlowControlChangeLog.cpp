@@ -0,0 +1,95 @@
+#include <SlowControlChangeLog.h>
+#include <JsonUtils.h>
+#include <vector>
+#include <chrono>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  // versions start from the wall clock time in ms, times 1024, so a version handed out by an earlier
+  // process is below this one's floor unless that process made over a million changes a second.
+  // That stays below 2^53 (exact as a JSON double) for a couple of centuries
+  uint64_t Epoch(){
+    
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count())<<10;
+    
+  }
+  
+}
+
+SlowControlChangeLog::SlowControlChangeLog(const size_t max_removed) : m_max_removed(max_removed), m_version(Epoch()), m_floor(m_version){}
+
+bool SlowControlChangeLog::Update(const std::string& snapshot_json){
+  
+  std::vector<std::pair<std::string, std::string_view> > controls;
+  if(!JsonUtils::SplitObject(snapshot_json, controls)) return false;
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  
+  std::set<std::string> present;
+  for(const std::pair<std::string, std::string_view>& control : controls){
+    if(m_ignored.count(control.first)) continue;
+    present.insert(control.first);
+    std::map<std::string, Entry>::iterator it = m_entries.find(control.first);
+    if(it==m_entries.end()) m_entries.emplace(control.first, Entry{std::string(control.second), ++m_version});
+    else if(it->second.json!=control.second){
+      it->second.json = control.second;
+      it->second.version = ++m_version;
+    }
+  }
+  
+  for(std::map<std::string, Entry>::iterator it=m_entries.begin(); it!=m_entries.end();){
+    if(present.count(it->first)){
+      ++it;
+      continue;
+    }
+    m_removed.emplace_back(++m_version, it->first);
+    it = m_entries.erase(it);
+  }
+  
+  while(m_removed.size()>m_max_removed){
+    m_floor = m_removed.front().first;
+    m_removed.pop_front();
+  }
+  
+  return true;
+  
+}
+
+std::string SlowControlChangeLog::Changes(const uint64_t since_version){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  
+  bool full = since_version==0 || since_version<m_floor || since_version>m_version;
+  JsonUtils::Writer changes;
+  for(const std::pair<const std::string, Entry>& entry : m_entries){
+    if(full || entry.second.version>since_version) changes.AddRaw(entry.first, entry.second.json);
+  }
+  
+  std::vector<std::string> removed;
+  if(!full){
+    for(const std::pair<uint64_t, std::string>& tombstone : m_removed){
+      // a control removed and then re-added is reported as a change only
+      if(tombstone.first>since_version && !m_entries.count(tombstone.second)) removed.push_back(tombstone.second);
+    }
+  }
+  
+  return JsonUtils::Writer().AddNumber("version", static_cast<int64_t>(m_version)).AddBool("full", full).AddRaw("changes", changes.str()).AddStrings("removed", removed).str();
+  
+}
+
+uint64_t SlowControlChangeLog::Version(){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_version;
+  
+}
+
+void SlowControlChangeLog::Ignore(const std::string& name){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  m_ignored.insert(name);
+  m_entries.erase(name);
+  
+}
@@ -0,0 +1,205 @@
+#include <SlowControlHistory.h>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  int64_t NowMs(){
+    
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    
+  }
+  
+}
+
+// ===========================================================================
+// SampleRing
+// ----------
+
+SampleRing::SampleRing(const size_t capacity) : m_slots(new Slot[capacity ? capacity : 1]), m_capacity(capacity ? capacity : 1), m_head(0){}
+
+void SampleRing::Push(const int64_t time_ms, const double value){
+  
+  uint64_t index = m_head.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = m_slots[index % m_capacity];
+  
+  slot.index.store(UINT64_MAX, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.time_ms.store(time_ms, std::memory_order_relaxed);
+  slot.value.store(value, std::memory_order_relaxed);
+  slot.index.store(index, std::memory_order_release);
+  
+}
+
+template<typename F> void SampleRing::Visit(const int64_t from_ms, const int64_t to_ms, F&& visit) const{
+  
+  uint64_t head = m_head.load(std::memory_order_acquire);
+  uint64_t oldest = (head>m_capacity) ? head-m_capacity : 0;
+  
+  for(uint64_t index=oldest; index<head; ++index){
+    const Slot& slot = m_slots[index % m_capacity];
+    if(slot.index.load(std::memory_order_acquire)!=index) continue; // overwritten already, or not yet written
+    int64_t time_ms = slot.time_ms.load(std::memory_order_relaxed);
+    double value = slot.value.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(slot.index.load(std::memory_order_relaxed)!=index) continue; // overwritten while we read it
+    if(time_ms>=from_ms && time_ms<=to_ms) visit(time_ms, value);
+  }
+  
+}
+
+size_t SampleRing::Range(const int64_t from_ms, const int64_t to_ms, std::vector<std::pair<int64_t, double> >& samples) const{
+  
+  samples.clear();
+  Visit(from_ms, to_ms, [&samples](const int64_t time_ms, const double value){ samples.emplace_back(time_ms, value); });
+  
+  return samples.size();
+  
+}
+
+SampleSummary SampleRing::Summarise(const int64_t from_ms, const int64_t to_ms) const{
+  
+  SampleSummary summary;
+  double sum=0, sum_squares=0;
+  summary.min = std::numeric_limits<double>::infinity();
+  summary.max = -std::numeric_limits<double>::infinity();
+  
+  Visit(from_ms, to_ms, [&](const int64_t time_ms, const double value){
+    if(summary.count==0) summary.first_ms = time_ms;
+    summary.last_ms = time_ms;
+    ++summary.count;
+    sum += value;
+    sum_squares += value*value;
+    summary.min = std::min(summary.min, value);
+    summary.max = std::max(summary.max, value);
+  });
+  
+  if(summary.count==0) return SampleSummary();
+  summary.mean = sum/summary.count;
+  summary.rms = std::sqrt(std::max(0.0, sum_squares/summary.count - summary.mean*summary.mean));
+  
+  return summary;
+  
+}
+
+size_t SampleRing::Capacity() const{
+  
+  return m_capacity;
+  
+}
+
+// ===========================================================================
+// SlowControlHistory
+// ------------------
+
+SlowControlHistory::SlowControlHistory(std::function<bool(const std::string&, double&)> read, const unsigned int period_ms) : m_read(read), m_period_ms(period_ms ? period_ms : 1), m_running(true){
+  
+  m_thread = std::thread(&SlowControlHistory::Thread, this);
+  
+}
+
+SlowControlHistory::~SlowControlHistory(){
+  
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_running=false;
+  }
+  m_cv.notify_all();
+  m_thread.join();
+  
+}
+
+bool SlowControlHistory::Enable(const std::string& name, const size_t samples){
+  
+  if(samples==0) return false;
+  
+  std::unique_lock<std::shared_mutex> lock(m_rings_mtx);
+  std::shared_ptr<SampleRing>& ring = m_rings[name];
+  if(!ring || ring->Capacity()!=samples) ring = std::make_shared<SampleRing>(samples);
+  
+  return true;
+  
+}
+
+void SlowControlHistory::Disable(const std::string& name){
+  
+  std::unique_lock<std::shared_mutex> lock(m_rings_mtx);
+  m_rings.erase(name);
+  
+}
+
+std::shared_ptr<SampleRing> SlowControlHistory::Find(const std::string& name){
+  
+  std::shared_lock<std::shared_mutex> lock(m_rings_mtx);
+  std::map<std::string, std::shared_ptr<SampleRing> >::iterator it = m_rings.find(name);
+  
+  return (it==m_rings.end()) ? nullptr : it->second;
+  
+}
+
+bool SlowControlHistory::Record(const std::string& name, const double value, const int64_t time_ms){
+  
+  std::shared_ptr<SampleRing> ring = Find(name);
+  if(!ring) return false;
+  ring->Push(time_ms ? time_ms : NowMs(), value);
+  
+  return true;
+  
+}
+
+bool SlowControlHistory::Range(const std::string& name, const int64_t from_ms, const int64_t to_ms, std::vector<std::pair<int64_t, double> >& samples){
+  
+  std::shared_ptr<SampleRing> ring = Find(name);
+  if(!ring) return false;
+  ring->Range(from_ms, to_ms, samples);
+  
+  return true;
+  
+}
+
+bool SlowControlHistory::Summarise(const std::string& name, const int64_t from_ms, const int64_t to_ms, SampleSummary& summary){
+  
+  std::shared_ptr<SampleRing> ring = Find(name);
+  if(!ring) return false;
+  summary = ring->Summarise(from_ms, to_ms);
+  
+  return true;
+  
+}
+
+bool SlowControlHistory::Last(const std::string& name, const int64_t seconds, SampleSummary& summary){
+  
+  int64_t now = NowMs();
+  
+  return Summarise(name, now - seconds*1000, now, summary);
+  
+}
+
+void SlowControlHistory::Thread(){
+  
+  std::unique_lock<std::mutex> lock(m_mtx);
+  std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+  std::vector<std::pair<std::string, std::shared_ptr<SampleRing> > > rings;
+  
+  while(true){
+    
+    next += std::chrono::milliseconds(m_period_ms);
+    if(m_cv.wait_until(lock, next, [this]{ return !m_running; })) return;
+    
+    {
+      std::shared_lock<std::shared_mutex> rings_lock(m_rings_mtx);
+      rings.assign(m_rings.begin(), m_rings.end());
+    }
+    
+    int64_t now = NowMs();
+    double value;
+    for(std::pair<std::string, std::shared_ptr<SampleRing> >& ring : rings){
+      if(m_read(ring.first, value)) ring.second->Push(now, value);
+    }
+    
+  }
+  
+}
@@ -0,0 +1,190 @@
+#include <SpanTracer.h>
+#include <unistd.h>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  // per thread nesting depth and the sampling decision of the outermost span
+  thread_local unsigned int span_depth=0;
+  thread_local bool span_sampled=false;
+  
+  unsigned int ThreadId(){
+    
+    static std::atomic<unsigned int> next_tid{1};
+    thread_local unsigned int tid = next_tid++;
+    
+    return tid;
+    
+  }
+  
+}
+
+SpanTracer::SpanTracer(const unsigned int sample_every, const size_t queue_size) : m_sample_every(sample_every ? sample_every : 1), m_calls(0), m_queue(queue_size), m_start(std::chrono::steady_clock::now()), m_file(nullptr), m_first(true), m_running(false), m_written(0), m_dropped(0){}
+
+SpanTracer::~SpanTracer(){
+  
+  Close();
+  
+}
+
+bool SpanTracer::Open(const std::string& trace_file){
+  
+  Close();
+  
+  m_file = fopen(trace_file.c_str(), "w");
+  if(!m_file) return false;
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", m_file);
+  m_first=true;
+  m_running=true;
+  m_thread = std::thread(&SpanTracer::Thread, this);
+  
+  return true;
+  
+}
+
+void SpanTracer::Close(){
+  
+  if(!m_file) return;
+  
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_running=false;
+  }
+  m_cv.notify_all();
+  m_thread.join(); // writes whatever is still queued
+  fputs("\n]}\n", m_file);
+  fclose(m_file);
+  m_file=nullptr;
+  
+}
+
+bool SpanTracer::Enter(){
+  
+  if(span_depth++==0) span_sampled = m_running && (m_calls.fetch_add(1, std::memory_order_relaxed) % m_sample_every)==0;
+  
+  return span_sampled;
+  
+}
+
+void SpanTracer::Leave(){
+  
+  --span_depth;
+  
+}
+
+bool SpanTracer::Sampled(){
+  
+  return m_running && span_depth && span_sampled;
+  
+}
+
+void SpanTracer::Record(const char* name, const char* category, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const int ok, const int64_t waited_us){
+  
+  // a span recorded outside any Scope is an outermost call of its own
+  if(span_depth ? !span_sampled : !(m_running && (m_calls.fetch_add(1, std::memory_order_relaxed) % m_sample_every)==0)) return;
+  Push(name, category, start, end, ok, waited_us);
+  
+}
+
+void SpanTracer::Push(const char* name, const char* category, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const int ok, const int64_t waited_us){
+  
+  Span span;
+  span.name = name;
+  span.category = category;
+  span.start_us = std::chrono::duration_cast<std::chrono::microseconds>(start - m_start).count();
+  span.duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+  span.tid = ThreadId();
+  span.ok = ok;
+  span.waited_us = waited_us;
+  if(!m_queue.Push(std::move(span))) ++m_dropped;
+  
+}
+
+void SpanTracer::Write(const Span& span){
+  
+  static const int pid = getpid();
+  
+  fprintf(m_file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%u", m_first ? "" : ",\n", span.name, span.category, static_cast<long long>(span.start_us), static_cast<long long>(span.duration_us), pid, span.tid);
+  if(span.ok>=0 || span.waited_us>=0){
+    fputs(",\"args\":{", m_file);
+    if(span.ok>=0) fprintf(m_file, "\"ok\":%s%s", span.ok ? "true" : "false", span.waited_us>=0 ? "," : "");
+    if(span.waited_us>=0) fprintf(m_file, "\"waited_us\":%lld", static_cast<long long>(span.waited_us));
+    fputc('}', m_file);
+  }
+  fputc('}', m_file);
+  m_first=false;
+  ++m_written;
+  
+}
+
+void SpanTracer::Thread(){
+  
+  Span span;
+  
+  while(true){
+    
+    bool wrote=false;
+    while(m_queue.Pop(span)){
+      Write(span);
+      wrote=true;
+    }
+    if(wrote) fflush(m_file); // keep the file usable if the process dies
+    
+    std::unique_lock<std::mutex> lock(m_mtx);
+    if(!m_running){
+      lock.unlock();
+      while(m_queue.Pop(span)) Write(span);
+      return;
+    }
+    m_cv.wait_for(lock, std::chrono::milliseconds(100));
+    
+  }
+  
+}
+
+unsigned long SpanTracer::Written(){
+  
+  return m_written;
+  
+}
+
+unsigned long SpanTracer::Dropped(){
+  
+  return m_dropped;
+  
+}
+
+// ===========================================================================
+// Scope
+// -----
+
+SpanTracer::Scope::Scope(SpanTracer* tracer, const char* name, const char* category) : m_tracer(tracer), m_name(name), m_category(category), m_sampled(false), m_ok(-1), m_waited_us(-1){
+  
+  if(!m_tracer) return;
+  m_sampled = m_tracer->Enter(); // unsampled scopes still count depth, so what they call isn't sampled either
+  if(m_sampled) m_start = std::chrono::steady_clock::now();
+  
+}
+
+SpanTracer::Scope::~Scope(){
+  
+  if(!m_tracer) return;
+  if(m_sampled) m_tracer->Push(m_name, m_category, m_start, std::chrono::steady_clock::now(), m_ok, m_waited_us);
+  m_tracer->Leave();
+  
+}
+
+bool SpanTracer::Scope::Ok(const bool ok){
+  
+  m_ok = ok;
+  
+  return ok;
+  
+}
+
+void SpanTracer::Scope::Waited(const std::chrono::steady_clock::duration waited){
+  
+  m_waited_us = std::chrono::duration_cast<std::chrono::microseconds>(waited).count();
+  
+}
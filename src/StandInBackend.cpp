@@ -0,0 +1,216 @@
+#include <StandInBackend.h>
+#include <thread>
+#include <chrono>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  // a JSON object of roughly the requested size
+  std::string Filler(const size_t bytes){
+    
+    const std::string head = "{\"data\":\"";
+    const std::string tail = "\"}";
+    
+    return head + std::string(bytes>head.size()+tail.size() ? bytes-head.size()-tail.size() : 0, 'x') + tail;
+    
+  }
+  
+}
+
+StandInBackend::StandInBackend(const unsigned int workers, const unsigned int base_latency_us, const double bytes_per_us, const size_t reply_bytes) : m_workers(workers ? workers : 1), m_base_latency_us(base_latency_us), m_bytes_per_us(bytes_per_us>0 ? bytes_per_us : 1), m_reply(Filler(reply_bytes)), m_busy(0), m_version(0), m_served(0), m_rejected(0), m_cancelled(0){}
+
+bool StandInBackend::Serve(const size_t request_bytes, const size_t reply_bytes, const unsigned int timeout){
+  
+  if(timeout==0){
+    ++m_served;
+    return true;
+  }
+  
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+  {
+    std::unique_lock<std::mutex> lock(m_mtx);
+    if(!m_cv.wait_until(lock, deadline, [this]{ return m_busy<m_workers; })){
+      ++m_rejected;
+      return false;
+    }
+    ++m_busy;
+  }
+  
+  std::chrono::microseconds service(m_base_latency_us + static_cast<uint64_t>((request_bytes+reply_bytes)/m_bytes_per_us));
+  std::chrono::steady_clock::time_point done = std::chrono::steady_clock::now() + service;
+  
+  // nobody reads a reply after the deadline, so stop work there and give the slot to the next request
+  bool cancelled = done>deadline;
+  std::this_thread::sleep_until(cancelled ? deadline : done);
+  
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    --m_busy;
+  }
+  m_cv.notify_one();
+  
+  if(cancelled) ++m_cancelled;
+  else ++m_served;
+  
+  return !cancelled;
+  
+}
+
+unsigned long StandInBackend::Served(){
+  
+  return m_served;
+  
+}
+
+unsigned long StandInBackend::Rejected(){
+  
+  return m_rejected;
+  
+}
+
+unsigned long StandInBackend::Cancelled(){
+  
+  return m_cancelled;
+  
+}
+
+bool StandInBackend::Read(std::string& json_data, int* version, const unsigned int timeout){
+  
+  if(!Serve(0, m_reply.size(), timeout)) return false;
+  json_data = m_reply;
+  if(version) *version = m_version;
+  
+  return true;
+  
+}
+
+bool StandInBackend::Write(const size_t request_bytes, int* version, const unsigned int timeout){
+  
+  if(!Serve(request_bytes, 0, timeout)) return false;
+  int created = ++m_version;
+  if(version) *version = created;
+  
+  return true;
+  
+}
+
+bool StandInBackend::SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout){
+  
+  responses.clear();
+  if(!Serve(query.size(), m_reply.size(), timeout)) return false;
+  responses.push_back(m_reply);
+  
+  return true;
+  
+}
+
+bool StandInBackend::SQLQuery(const std::string& query, std::string& response, const unsigned int timeout){
+  
+  if(!Serve(query.size(), m_reply.size(), timeout)) return false;
+  response = m_reply;
+  
+  return true;
+  
+}
+
+bool StandInBackend::SQLQuery(const std::string& query, const unsigned int timeout){
+  
+  return Serve(query.size(), 0, timeout);
+  
+}
+
+bool StandInBackend::SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp){
+  
+  return Serve(message.size(), 0, 0);
+  
+}
+
+bool StandInBackend::SendAlarm(const std::string& message, bool critical, const std::string& device, const uint64_t timestamp, const unsigned int timeout){
+  
+  return Serve(message.size(), 0, timeout);
+  
+}
+
+bool StandInBackend::SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp){
+  
+  return Serve(json_data.size(), 0, 0);
+  
+}
+
+bool StandInBackend::SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
+  
+  return Write(json_data.size()+description.size(), version, timeout);
+  
+}
+
+bool StandInBackend::GetCalibrationData(std::string& json_data, int& version, const std::string& device, const unsigned int timeout){
+  
+  return Read(json_data, &version, timeout);
+  
+}
+
+bool StandInBackend::SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
+  
+  return Write(json_data.size()+description.size(), version, timeout);
+  
+}
+
+bool StandInBackend::GetDeviceConfig(std::string& json_data, const int version, const std::string& device, const unsigned int timeout){
+  
+  return Read(json_data, nullptr, timeout);
+  
+}
+
+bool StandInBackend::GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout){
+  
+  return Read(json_data, nullptr, timeout);
+  
+}
+
+bool StandInBackend::GetRunModeConfig(std::string& json_data, const std::string& name, const int version, const unsigned int timeout){
+  
+  return Read(json_data, nullptr, timeout);
+  
+}
+
+bool StandInBackend::GetRunDeviceConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, int* version, const unsigned int timeout){
+  
+  return Read(json_data, version, timeout);
+  
+}
+
+bool StandInBackend::SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  return Write(json_data.size(), version, timeout);
+  
+}
+
+bool StandInBackend::GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int& version, const unsigned int timeout){
+  
+  draw_options.clear();
+  return Read(json_data, &version, timeout);
+  
+}
+
+bool StandInBackend::SendPlotlyPlot(const std::string& name, const std::string& json_trace, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  return Write(json_trace.size()+json_layout.size(), version, timeout);
+  
+}
+
+bool StandInBackend::SendPlotlyPlot(const std::string& name, const std::vector<std::string>& json_traces, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  size_t bytes=json_layout.size();
+  for(const std::string& trace : json_traces) bytes+=trace.size();
+  
+  return Write(bytes, version, timeout);
+  
+}
+
+bool StandInBackend::GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int& version, const unsigned int timeout){
+  
+  json_layout = "{}";
+  return Read(json_trace, &version, timeout);
+  
+}
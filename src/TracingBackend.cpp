@@ -0,0 +1,241 @@
+#include <TracingBackend.h>
+
+using namespace ToolFramework;
+
+namespace {
+  
+  size_t Total(const std::vector<std::string>& strings){
+    
+    size_t bytes=0;
+    for(const std::string& string : strings) bytes+=string.size();
+    
+    return bytes;
+    
+  }
+  
+}
+
+TracingBackend::TracingBackend(DAQBackend* backend) : m_backend(backend){}
+
+TracingBackend::~TracingBackend(){
+  
+  m_trace.Close();
+  delete m_backend;
+  m_backend=0;
+  
+}
+
+bool TracingBackend::Open(const std::string& trace_file){
+  
+  return m_trace.Open(trace_file);
+  
+}
+
+bool TracingBackend::Reload(Store& vars){
+  
+  return m_backend->Reload(vars);
+  
+}
+
+void TracingBackend::SetSpanTracer(SpanTracer* spans){
+  
+  m_spans = spans;
+  
+}
+
+void TracingBackend::Record(const TraceCall call, const std::chrono::steady_clock::time_point start, const size_t request_bytes, const size_t reply_bytes, const unsigned int timeout_ms, const bool ok){
+  
+  m_trace.Record(call, start, request_bytes, reply_bytes, timeout_ms, ok); // no-op unless a trace file is open
+  if(m_spans) m_spans->Record(TraceCallName(call), "services", start, std::chrono::steady_clock::now(), ok);
+  
+}
+
+bool TracingBackend::SQLQuery(const std::string& query, std::vector<std::string>& responses, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->SQLQuery(query, responses, timeout);
+  Record(TraceCall::SQLQuery, start, query.size(), Total(responses), timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::SQLQuery(const std::string& query, std::string& response, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->SQLQuery(query, response, timeout);
+  Record(TraceCall::SQLQuery, start, query.size(), response.size(), timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::Probe(const std::string& query, std::string& response, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->Probe(query, response, timeout);
+  Record(TraceCall::SQLQuery, start, query.size(), response.size(), timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::SQLQuery(const std::string& query, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->SQLQuery(query, timeout);
+  Record(TraceCall::SQLQuery, start, query.size(), 0, timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::SendLog(const std::string& message, LogLevel severity, const std::string& device, const uint64_t timestamp){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->SendLog(message, severity, device, timestamp);
+  Record(TraceCall::SendLog, start, message.size(), 0, 0, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::SendAlarm(const std::string& message, bool critical, const std::string& device, const uint64_t timestamp, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->SendAlarm(message, critical, device, timestamp, timeout);
+  Record(TraceCall::SendAlarm, start, message.size(), 0, timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::SendMonitoringData(const std::string& json_data, const std::string& subject, const std::string& device, const uint64_t timestamp){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->SendMonitoringData(json_data, subject, device, timestamp);
+  Record(TraceCall::SendMonitoringData, start, json_data.size(), 0, 0, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::SendCalibrationData(const std::string& json_data, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->SendCalibrationData(json_data, description, device, timestamp, version, timeout);
+  Record(TraceCall::SendCalibrationData, start, json_data.size()+description.size(), 0, timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::GetCalibrationData(std::string& json_data, int& version, const std::string& device, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->GetCalibrationData(json_data, version, device, timeout);
+  Record(TraceCall::GetCalibrationData, start, 0, json_data.size(), timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::SendDeviceConfig(const std::string& json_data, const std::string& author, const std::string& description, const std::string& device, const uint64_t timestamp, int* version, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->SendDeviceConfig(json_data, author, description, device, timestamp, version, timeout);
+  Record(TraceCall::SendDeviceConfig, start, json_data.size()+description.size(), 0, timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::GetDeviceConfig(std::string& json_data, const int version, const std::string& device, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->GetDeviceConfig(json_data, version, device, timeout);
+  Record(TraceCall::GetDeviceConfig, start, 0, json_data.size(), timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::GetRunConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->GetRunConfig(json_data, base_config_id, runmode_config_id, timeout);
+  Record(TraceCall::GetRunConfig, start, 0, json_data.size(), timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::GetRunModeConfig(std::string& json_data, const std::string& name, const int version, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->GetRunModeConfig(json_data, name, version, timeout);
+  Record(TraceCall::GetRunModeConfig, start, 0, json_data.size(), timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::GetRunDeviceConfig(std::string& json_data, const int base_config_id, const int runmode_config_id, const std::string& device, int* version, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->GetRunDeviceConfig(json_data, base_config_id, runmode_config_id, device, version, timeout);
+  Record(TraceCall::GetRunDeviceConfig, start, 0, json_data.size(), timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::SendROOTplot(const std::string& plot_name, const std::string& draw_options, const std::string& json_data, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->SendROOTplot(plot_name, draw_options, json_data, version, timestamp, lifetime, timeout);
+  Record(TraceCall::SendROOTplot, start, json_data.size(), 0, timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::GetROOTplot(const std::string& plot_name, std::string& draw_options, std::string& json_data, int& version, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->GetROOTplot(plot_name, draw_options, json_data, version, timeout);
+  Record(TraceCall::GetROOTplot, start, 0, json_data.size(), timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::SendPlotlyPlot(const std::string& name, const std::string& json_trace, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->SendPlotlyPlot(name, json_trace, json_layout, version, timestamp, lifetime, timeout);
+  Record(TraceCall::SendPlotlyPlot, start, json_trace.size()+json_layout.size(), 0, timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::SendPlotlyPlot(const std::string& name, const std::vector<std::string>& json_traces, const std::string& json_layout, int* version, const uint64_t timestamp, const unsigned int lifetime, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->SendPlotlyPlot(name, json_traces, json_layout, version, timestamp, lifetime, timeout);
+  Record(TraceCall::SendPlotlyPlot, start, Total(json_traces)+json_layout.size(), 0, timeout, ok);
+  
+  return ok;
+  
+}
+
+bool TracingBackend::GetPlotlyPlot(const std::string& name, std::string& json_trace, std::string& json_layout, int& version, const unsigned int timeout){
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ok = m_backend->GetPlotlyPlot(name, json_trace, json_layout, version, timeout);
+  Record(TraceCall::GetPlotlyPlot, start, 0, json_trace.size()+json_layout.size(), timeout, ok);
+  
+  return ok;
+  
+}
@@ -0,0 +1,83 @@
+#include <UploadDeduplicator.h>
+
+using namespace ToolFramework;
+
+UploadDeduplicator::UploadDeduplicator(const unsigned int refresh_s) : m_refresh(refresh_s), m_hits(0), m_misses(0), m_bytes_saved(0){}
+
+uint64_t UploadDeduplicator::Hash(std::initializer_list<std::string_view> parts){
+  
+  uint64_t hash = 14695981039346656037ULL;
+  for(const std::string_view& part : parts){
+    for(const char c : part){
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ULL;
+    }
+    // fold in the length so moving bytes between parts changes the hash
+    uint64_t length = part.size();
+    for(int i=0; i<8; ++i){
+      hash ^= (length>>(8*i)) & 0xff;
+      hash *= 1099511628211ULL;
+    }
+  }
+  
+  return hash;
+  
+}
+
+bool UploadDeduplicator::IsDuplicate(const std::string& key, const uint64_t hash, const size_t bytes, int* version){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  
+  std::map<std::string, Entry>::iterator it = m_entries.find(key);
+  // a caller asking for the version can't be answered if the previous upload didn't report one
+  if(it==m_entries.end() || it->second.hash!=hash || (version && it->second.version<0) || (m_refresh.count() && std::chrono::steady_clock::now()-it->second.sent>=m_refresh)){
+    ++m_misses;
+    return false;
+  }
+  
+  if(version) *version = it->second.version;
+  ++m_hits;
+  m_bytes_saved+=bytes;
+  
+  return true;
+  
+}
+
+void UploadDeduplicator::Sent(const std::string& key, const uint64_t hash, const int version){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  m_entries[key] = Entry{hash, version, std::chrono::steady_clock::now()};
+  
+}
+
+void UploadDeduplicator::Forget(const std::string& key){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  m_entries.erase(key);
+  
+}
+
+void UploadDeduplicator::Clear(){
+  
+  std::lock_guard<std::mutex> lock(m_mtx);
+  m_entries.clear();
+  
+}
+
+unsigned long UploadDeduplicator::Hits(){
+  
+  return m_hits;
+  
+}
+
+unsigned long UploadDeduplicator::Misses(){
+  
+  return m_misses;
+  
+}
+
+unsigned long long UploadDeduplicator::BytesSaved(){
+  
+  return m_bytes_saved;
+  
+}